@@ -0,0 +1,73 @@
+// GUI-thread data structures without any processes: JobModel inserts,
+// progress updates and removals, LogStore appends, and Report aggregation
+// and rendering, at 1k/10k/100k jobs.
+//   bench_model [jobs...]
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <cstdio>
+#include <sys/resource.h>
+#include "app/JobModel.hpp"
+#include "app/LogStore.hpp"
+#include "app/Report.hpp"
+
+template<class F>
+static double nsPerOp(int ops, F&& f) {
+    QElapsedTimer t;
+    t.start();
+    f();
+    return double(t.nsecsElapsed()) / std::max(1, ops);
+}
+
+static void runSize(int n) {
+    JobModel jobs;
+    LogStore logs;
+    Report report;
+    jobs.setLogStore(&logs);
+    QStringList ids;
+    ids.reserve(n);
+    QRandomGenerator rng(42);   // fixed seed: runs are comparable
+
+    const double add = nsPerOp(n, [&]{
+        for (int i=0;i<n;++i) ids << jobs.addJob(0, 0, QString("/in/%1.cue").arg(i), QString("/out/%1.chd").arg(i), {}, false, true);
+    });
+    const int updates = 20*n;
+    const double upd = nsPerOp(updates, [&]{
+        for (int k=0;k<updates;++k) {
+            const QString& id = ids[rng.bounded(n)];
+            jobs.updateJob(id, [k](Job& j){ j.progress = k % 101; }, {JobModel::ProgressRole});
+        }
+        jobs.flushUpdates();
+    });
+    const int lines = 20*n;
+    const double log = nsPerOp(lines, [&]{
+        for (int k=0;k<lines;++k) logs.append(ids[k % n], QStringLiteral("Compressing, 42.0% complete... (ratio=55.0%)"));
+    });
+    const double rep = nsPerOp(n, [&]{
+        for (int i=0;i<n;++i) {
+            report.add({ ids[i], i%10!=0, 700ull<<20, 400ull<<20, 60000, "/in/x.cue", "/out/x.chd", "Done" });
+            (void)report.ok(); (void)report.savedPct();   // what the QML bindings read per update
+        }
+    });
+    QElapsedTimer t; t.start();
+    const qsizetype mdSize = report.asMarkdown().size();
+    const qint64 mdMs = t.elapsed();
+    const int removals = std::min(n, 1000);
+    const double rem = nsPerOp(removals, [&]{
+        for (int i=0;i<removals;++i) jobs.removeJob(ids[rng.bounded(n-i)]);
+    });
+    rusage ru{}; getrusage(RUSAGE_SELF, &ru);
+    std::printf("%7d jobs  add %7.0f ns  update %7.0f ns  log %6.0f ns  report.add %8.0f ns  "
+                "remove %9.0f ns  markdown %6lld ms (%lld chars)  peak RSS %7ld KiB\n",
+                n, add, upd, log, rep, rem, qint64(mdMs), qint64(mdSize), ru.ru_maxrss);
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    QList<int> sizes;
+    for (const auto& a : app.arguments().mid(1)) sizes << a.toInt();
+    if (sizes.isEmpty()) sizes = { 1000, 10000, 100000 };
+    for (int n : sizes) runSize(n);
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Scheduler scalability: pushes 1k/10k/100k jobs through ChdmanRunner with
+// the fake chdman and the same JobModel/LogStore/Report wiring as the GUI,
+// then reports wall time, per-job scheduler CPU, event-loop latency and
+// peak memory.
+//   bench_runner [jobs...] [-j concurrency] [--worker address]...
+// With --worker, jobs beyond the local slots run on those opendhc-worker
+// processes (start them with --chdman pointing at fake-chdman).
+// Environment for the fake binary (FAKE_CHDMAN_*) is passed through; the
+// default job time is 0 ms so that only OpenDHC's own overhead is measured.
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+#include <sys/resource.h>
+#include "app/ChdmanRunner.hpp"
+#include "app/JobModel.hpp"
+#include "app/LogStore.hpp"
+#include "app/Report.hpp"
+
+static double cpuSeconds() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static long peakRssKb() {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+static void runBatch(int n, int concurrency, const QStringList& workers, const QString& workDir) {
+    JobModel jobs;
+    LogStore logs;
+    Report report;
+    ChdmanRunner runner;
+    jobs.setLogStore(&logs);
+    logs.setSpillDir(workDir + "/logs");
+    runner.setChdmanPath(FAKE_CHDMAN_PATH);
+    runner.setConcurrency(concurrency);
+    if (!workers.isEmpty()) {
+        // Wait until every worker said hello, so the batch sees full capacity
+        runner.setWorkerToken(qEnvironmentVariable("OPENDHC_WORKER_TOKEN"));
+        runner.setWorkers(workers);
+        QElapsedTimer wait;
+        wait.start();
+        while (runner.remoteSlots()==0 && wait.elapsed()<5000) QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 200);
+        std::printf("remote slots: %d\n", runner.remoteSlots());
+    }
+
+    QObject::connect(&runner,&ChdmanRunner::jobProgress,&jobs,[&](const QString& id, int p){
+        jobs.updateJob(id,[p](Job& j){ j.progress=p; }, {JobModel::ProgressRole});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobLog,&jobs,[&](const QString& id, const QString& line){
+        logs.append(id, line);
+        jobs.updateJob(id, nullptr, {JobModel::LogRole});
+    });
+    int finished = 0;
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&jobs,[&](const QString& id, bool ok){
+        jobs.updateJob(id,[ok](Job& j){ j.status = ok ? "Done" : "Failed"; }, {JobModel::StatusRole});
+        logs.finish(id);
+        const auto& j = jobs.jobRefById(id);
+        report.add({ id, ok, 0, 0, 0, j.inputPath, j.outputPath, j.status, logs.spillPath(id) });
+        if (++finished==n) QCoreApplication::quit();
+    });
+
+    // Event-loop latency: how late a 5 ms timer fires while the batch runs
+    QList<qint64> lateness;
+    QElapsedTimer tick;
+    QTimer probe;
+    probe.setInterval(5);
+    QObject::connect(&probe,&QTimer::timeout,[&]{
+        if (tick.isValid()) lateness << std::max<qint64>(0, tick.nsecsElapsed()/1000 - 5000);
+        tick.restart();
+    });
+
+    const double cpu0 = cpuSeconds();
+    QElapsedTimer wall;
+    wall.start();
+    for (int i=0; i<n; ++i) {
+        const QString id = jobs.addJob(0, 0, workDir + QString("/in/%1.cue").arg(i),
+                                       workDir + QString("/out/%1.chd").arg(i), {}, false, true);
+        runner.enqueueSimple(id, 0, 0, workDir + QString("/in/%1.cue").arg(i),
+                             workDir + QString("/out/%1.chd").arg(i), {}, false, true);
+    }
+    const qint64 enqueueMs = wall.elapsed();
+    probe.start();
+    QCoreApplication::exec();
+    probe.stop();
+    const double secs = wall.elapsed() / 1000.0;
+    const double cpu = cpuSeconds() - cpu0;
+
+    std::sort(lateness.begin(), lateness.end());
+    const auto pct = [&](double p){ return lateness.isEmpty() ? 0 : lateness[int(p*(lateness.size()-1))]; };
+    std::printf("%7d jobs  wall %8.2f s  %8.1f jobs/s  enqueue %6lld ms  sched CPU %7.1f us/job  "
+                "loop lateness p50 %6lld us  p99 %6lld us  max %7lld us  peak RSS %7ld KiB\n",
+                n, secs, n/secs, qint64(enqueueMs), cpu*1e6/n,
+                qint64(pct(0.5)), qint64(pct(0.99)), qint64(pct(1.0)), peakRssKb());
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    qputenv("FAKE_CHDMAN_MS", qgetenv("FAKE_CHDMAN_MS").isEmpty() ? "0" : qgetenv("FAKE_CHDMAN_MS"));
+
+    QList<int> sizes;
+    int concurrency = 8;
+    QStringList workers;
+    const QStringList args = app.arguments().mid(1);
+    for (int i=0; i<args.size(); ++i) {
+        if (args[i]=="-j" && i+1<args.size()) concurrency = args[++i].toInt();
+        else if (args[i]=="--worker" && i+1<args.size()) workers << args[++i];
+        else sizes << args[i].toInt();
+    }
+    if (sizes.isEmpty()) sizes = { 1000, 10000, 100000 };
+
+    QTemporaryDir work;
+    QDir(work.path()).mkpath("in");
+    QDir(work.path()).mkpath("out");
+    for (int n : sizes) runBatch(n, concurrency, workers, work.path());
+    return 0;
+}
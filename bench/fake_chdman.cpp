@@ -0,0 +1,82 @@
+// Deterministic stand-in for chdman, for benchmarks. Accepts the verbs that
+// ChdmanRunner::buildArgs produces and behaves according to environment:
+//   FAKE_CHDMAN_MS           run time per job in ms (default 200)
+//   FAKE_CHDMAN_PROGRESS_HZ  progress redraws per second (default 10)
+//   FAKE_CHDMAN_OUT_BYTES    bytes written to -o for create/extract (default 4096)
+//   FAKE_CHDMAN_BURN         1 = spin the CPU instead of sleeping
+//   FAKE_CHDMAN_FAIL         1 = exit with status 1
+// Plain C++ so that process start-up stays negligible.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static long envInt(const char* name, long def) {
+    const char* v = std::getenv(name);
+    return v && *v ? std::strtol(v, nullptr, 10) : def;
+}
+
+static void spend(Clock::duration d, bool burn) {
+    if (!burn) { std::this_thread::sleep_for(d); return; }
+    const auto until = Clock::now() + d;
+    volatile unsigned long x = 0;
+    while (Clock::now() < until) for (int i=0;i<10000;++i) x = x*1664525u + 1013904223u;
+}
+
+static bool writeOutput(const std::string& path, long bytes) {
+    if (path.empty()) return true;
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::vector<char> buf(1 << 16, 'C');
+    while (bytes > 0) {
+        const size_t n = size_t(std::min<long>(bytes, long(buf.size())));
+        std::fwrite(buf.data(), 1, n, f);
+        bytes -= long(n);
+    }
+    return std::fclose(f)==0;
+}
+
+int main(int argc, char** argv) {
+    if (argc<2) { std::fprintf(stderr, "usage: chdman <verb> [options]\n"); return 1; }
+    const std::string verb = argv[1];
+    if (verb=="-help" || verb=="--help") { std::printf("fake chdman\n"); return 0; }
+
+    std::string in, out;
+    for (int i=2; i+1<argc; ++i) {
+        if (!std::strcmp(argv[i],"-i")) in = argv[++i];
+        else if (!std::strcmp(argv[i],"-o")) out = argv[++i];
+    }
+    const long ms = envInt("FAKE_CHDMAN_MS", 200);
+    const long hz = std::max(1L, envInt("FAKE_CHDMAN_PROGRESS_HZ", 10));
+    const long outBytes = envInt("FAKE_CHDMAN_OUT_BYTES", 4096);
+    const bool burn = envInt("FAKE_CHDMAN_BURN", 0)!=0;
+    const bool fail = envInt("FAKE_CHDMAN_FAIL", 0)!=0;
+
+    const char* action = "Compressing";
+    const char* done = "Compression";
+    const bool writes = verb.rfind("create",0)==0 || verb.rfind("extract",0)==0;
+    if (verb.rfind("extract",0)==0) { action = "Extracting"; done = "Extraction"; }
+    else if (verb=="verify") { action = "Verifying"; done = "Verification"; }
+    else if (verb=="info") {
+        std::printf("Input file:   %s\nFile Version: 5\nHunk Size:    19584 bytes\n", in.c_str());
+        return fail ? 1 : 0;
+    }
+
+    const long steps = std::max(1L, ms * hz / 1000);
+    const auto step = std::chrono::milliseconds(ms) / steps;
+    for (long s=0; s<steps; ++s) {
+        spend(step, burn);
+        const double pct = 100.0 * double(s+1) / double(steps);
+        std::fprintf(stderr, "%s, %.1f%% complete... (ratio=50.0%%)\r", action, pct);
+        std::fflush(stderr);
+    }
+    if (writes && !writeOutput(out, outBytes)) { std::fprintf(stderr, "\nError writing %s\n", out.c_str()); return 1; }
+    std::fprintf(stderr, "\n%s complete ... final ratio = 50.0%%\n", done);
+    return fail ? 1 : 0;
+}
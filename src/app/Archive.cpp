@@ -0,0 +1,159 @@
+#include "Archive.hpp"
+#include "SizeUtil.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <algorithm>
+
+#ifdef OPENDHC_HAVE_LIBARCHIVE
+#include <archive.h>
+#include <archive_entry.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool Archive::supported() {
+#ifdef OPENDHC_HAVE_LIBARCHIVE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Archive::isArchive(const QString& path) {
+    const QString ext = QFileInfo(path).suffix().toLower();
+    return ext=="zip" || ext=="7z" || ext=="rar";
+}
+
+bool Archive::split(const QString& input, QString* archive, QString* member) {
+    static const QRegularExpression sep("\\.(zip|7z|rar)#", QRegularExpression::CaseInsensitiveOption);
+    const auto m = sep.match(input);
+    if (!m.hasMatch()) return false;
+    const int at = m.capturedEnd() - 1;   // the '#'
+    if (archive) *archive = input.left(at);
+    if (member) *member = input.mid(at + 1);
+    return true;
+}
+
+quint64 Archive::footprint(const QList<Member>& members, const QString& member) {
+    const QString dir = QFileInfo(member).path();
+    quint64 total = 0;
+    for (const auto& m : members)
+        if (QFileInfo(m.name).path()==dir) total += m.size;
+    return total;
+}
+
+#ifdef OPENDHC_HAVE_LIBARCHIVE
+
+namespace {
+struct Reader {
+    archive* a = archive_read_new();
+    ~Reader() { archive_read_free(a); }
+    bool open(const QString& path) {
+        archive_read_support_filter_all(a);
+        archive_read_support_format_all(a);
+        return archive_read_open_filename(a, QFile::encodeName(path).constData(), 1 << 20)==ARCHIVE_OK;
+    }
+    QString error() const { return QString::fromLocal8Bit(archive_error_string(a)); }
+};
+
+QString entryName(archive_entry* e) {
+    if (const char* u = archive_entry_pathname_utf8(e)) return QString::fromUtf8(u);
+    return QFile::decodeName(archive_entry_pathname(e));
+}
+
+// Archive paths are untrusted: no absolute paths, no way out of destDir
+QString safeRelative(const QString& name) {
+    const QString clean = QDir::cleanPath(QString(name).replace('\\', '/'));
+    if (clean.isEmpty() || clean.startsWith('/') || clean==".." || clean.startsWith("../")) return QString();
+    return clean;
+}
+
+bool writeEntry(archive* a, const QString& path, const std::atomic<bool>* cancelled) {
+    QDir().mkpath(QFileInfo(path).path());
+    const int fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd<0) return false;
+    const void* buf; size_t size; la_int64_t offset;
+    int r;
+    bool ok = true;
+    while ((r = archive_read_data_block(a, &buf, &size, &offset))==ARCHIVE_OK) {
+        if (cancelled && *cancelled) { ok = false; break; }
+        if (::pwrite(fd, buf, size, offset)!=ssize_t(size)) { ok = false; break; }
+    }
+    ok = ok && (r==ARCHIVE_EOF || r==ARCHIVE_OK);
+    return ::close(fd)==0 && ok;
+}
+
+// One pass over the archive, unpacking the entries named in `wanted`
+bool unpack(const QString& archivePath, const QSet<QString>& wanted, const QString& destDir,
+            QString* error, const std::atomic<bool>* cancelled) {
+    Reader r;
+    if (!r.open(archivePath)) { if (error) *error = r.error(); return false; }
+    archive_entry* e;
+    int left = int(wanted.size());
+    while (left>0 && archive_read_next_header(r.a, &e)==ARCHIVE_OK) {
+        if (cancelled && *cancelled) { if (error) *error = "cancelled"; return false; }
+        const QString rel = safeRelative(entryName(e));
+        if (archive_entry_filetype(e)!=AE_IFREG || !wanted.contains(rel)) { archive_read_data_skip(r.a); continue; }
+        if (!writeEntry(r.a, QDir(destDir).filePath(rel), cancelled)) {
+            if (error) *error = (cancelled && *cancelled) ? QString("cancelled") : "cannot unpack " + rel + ": " + r.error();
+            return false;
+        }
+        --left;
+    }
+    if (left>0 && error) *error = "missing in archive: " + QStringList(wanted.values()).join(", ");
+    return left==0;
+}
+}
+
+QList<Archive::Member> Archive::list(const QString& archivePath, QString* error) {
+    QList<Member> out;
+    Reader r;
+    if (!r.open(archivePath)) { if (error) *error = r.error(); return out; }
+    archive_entry* e;
+    while (archive_read_next_header(r.a, &e)==ARCHIVE_OK) {
+        if (archive_entry_filetype(e)==AE_IFREG) {
+            const QString rel = safeRelative(entryName(e));
+            if (!rel.isEmpty()) out << Member{ rel, quint64(std::max<la_int64_t>(0, archive_entry_size(e))) };
+        }
+        archive_read_data_skip(r.a);
+    }
+    return out;
+}
+
+// Descriptors are unpacked first and parsed with SizeUtil, so only the
+// tracks of this disc are unpacked, not the whole archive.
+QString Archive::extract(const QString& input, const QString& destDir, QString* error,
+                         const std::atomic<bool>* cancelled) {
+    QString archivePath, member;
+    if (!split(input, &archivePath, &member)) { if (error) *error = "not an archive member"; return QString(); }
+    member = safeRelative(member);
+    if (member.isEmpty()) { if (error) *error = "bad member name"; return QString(); }
+    if (!unpack(archivePath, { member }, destDir, error, cancelled)) return QString();
+
+    const QString unpacked = QDir(destDir).filePath(member);
+    QSet<QString> tracks;
+    const QDir root(destDir);
+    for (const auto& t : SizeUtil::trackFiles(unpacked)) {
+        const QString rel = safeRelative(root.relativeFilePath(t));
+        if (!rel.isEmpty() && rel!=member) tracks.insert(rel);
+    }
+    if (!tracks.isEmpty() && !unpack(archivePath, tracks, destDir, error, cancelled)) return QString();
+    return unpacked;
+}
+
+#else
+
+QList<Archive::Member> Archive::list(const QString&, QString* error) {
+    if (error) *error = "built without libarchive";
+    return {};
+}
+
+QString Archive::extract(const QString&, const QString&, QString* error, const std::atomic<bool>*) {
+    if (error) *error = "built without libarchive";
+    return QString();
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <atomic>
+
+// Discs inside .zip/.7z/.rar archives, read through libarchive when the build
+// has it (OPENDHC_HAVE_LIBARCHIVE). A disc in an archive is addressed as
+// "<archive>#<member>", e.g. "/dumps/Game.7z#Game (Disc 1).cue".
+namespace Archive {
+    struct Member { QString name; quint64 size = 0; };
+
+    bool supported();
+    bool isArchive(const QString& path);
+    // Splits a member path; false for plain files
+    bool split(const QString& input, QString* archive, QString* member);
+    inline bool isMember(const QString& input) { return split(input, nullptr, nullptr); }
+
+    // Regular files in the archive, from its headers only
+    QList<Member> list(const QString& archive, QString* error = nullptr);
+    // Bytes the member's disc takes once unpacked: the files in its folder
+    quint64 footprint(const QList<Member>& members, const QString& member);
+
+    // Unpacks one disc (a descriptor and the tracks it names, or an image)
+    // under destDir, keeping the archive's relative paths. Returns the path
+    // of the unpacked member.
+    QString extract(const QString& input, const QString& destDir, QString* error,
+                    const std::atomic<bool>* cancelled = nullptr);
+}
@@ -1,6 +1,120 @@
 #include "BatchScanner.hpp"
+#include "Archive.hpp"
+#include "Dedup.hpp"
+#include "SizeUtil.hpp"
 #include <QFileInfo>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QUrl>
 #include <QUuid>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+enum class InputKind { None, CD, DVD, Archive };
+
+static InputKind classifyName(const char* name) {
+    const char* dot = std::strrchr(name, '.');
+    if (!dot) return InputKind::None;
+    const char* ext = dot + 1;
+    if (!strcasecmp(ext,"cue") || !strcasecmp(ext,"toc") || !strcasecmp(ext,"gdi")) return InputKind::CD;
+    if (!strcasecmp(ext,"iso")) return InputKind::DVD;
+    if (!strcasecmp(ext,"zip") || !strcasecmp(ext,"7z") || !strcasecmp(ext,"rar")) return InputKind::Archive;
+    return InputKind::None;
+}
+
+// Reads one directory with readdir() and classifies entries from d_type, so
+// regular files are never stat()ed. Only symlinks with a matching suffix and
+// entries reported as DT_UNKNOWN fall back to fstatat(). Symlinked directories
+// are not descended, same as QDirIterator without FollowSymlinks.
+// Callbacks receive entry names; returns the number of regular files seen.
+template<class OnInput, class OnDir>
+static int listDir(const QByteArray& dir, OnInput&& onInput, OnDir&& onDir) {
+    DIR* d = opendir(dir.constData());
+    if (!d) return 0;
+    const int fd = dirfd(d);
+    int files = 0;
+    while (dirent* e = readdir(d)) {
+        const char* name = e->d_name;
+        if (name[0]=='.' && (name[1]==0 || (name[1]=='.' && name[2]==0))) continue;
+        unsigned char type = e->d_type;
+        if (type==DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW)!=0) continue;
+            type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR
+                 : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+        }
+        if (type==DT_DIR) { onDir(name); continue; }
+        const InputKind kind = classifyName(name);
+        if (type==DT_LNK) {
+            if (kind==InputKind::None) continue;
+            struct stat st;
+            if (fstatat(fd, name, &st, 0)!=0 || !S_ISREG(st.st_mode)) continue;
+            type = DT_REG;
+        }
+        if (type!=DT_REG) continue;
+        ++files;
+        if (kind!=InputKind::None) onInput(name, kind);
+    }
+    closedir(d);
+    return files;
+}
+
+static QByteArray joinPath(const QByteArray& dir, const QByteArray& name) {
+    return dir.endsWith('/') ? dir + name : dir + '/' + name;
+}
+
+static qint64 mtimeNs(const struct stat& st) {
+    return qint64(st.st_mtim.tv_sec)*1000000000 + st.st_mtim.tv_nsec;
+}
+
+static bool wanted(InputKind k, bool includeCD, bool includeDVD) {
+    return (k==InputKind::CD && includeCD) || (k==InputKind::DVD && includeDVD);
+}
+
+// QML dialogs hand us file:// URLs
+static QString localPath(const QString& p) {
+    return p.startsWith("file:") ? QUrl(p).toLocalFile() : p;
+}
+
+static QByteArray localDirName(const QString& sourceDir) {
+    return QFile::encodeName(QDir::cleanPath(localPath(sourceDir)));
+}
+
+// Depth-first walk on the calling thread; used by the synchronous helpers.
+template<class OnInput>
+static void walkSync(const QString& sourceDir, bool recursive, OnInput&& onInput) {
+    QList<QByteArray> stack{ localDirName(sourceDir) };
+    while (!stack.isEmpty()) {
+        const QByteArray dir = stack.takeLast();
+        listDir(dir,
+                [&](const char* name, InputKind kind){ onInput(joinPath(dir, name), kind); },
+                [&](const char* name){ if (recursive) stack << joinPath(dir, name); });
+    }
+}
+
+struct BatchScanner::ScanState {
+    BatchScanner* owner = nullptr;
+    QThreadPool* pool = nullptr;
+    ScanCache* cache = nullptr;
+    bool recursive = true, includeCD = true, includeDVD = true, includeArchives = false;
+    // Up-to-date filtering (Create/Extract only)
+    bool skipUpToDate = false, preserve = true;
+    bool dedup = false;
+    JobType jobType = JobType::Create;
+    QString outRoot, sourceRoot;
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> pending{0};
+    std::atomic<int> dirs{0}, files{0}, matched{0}, skipped{0};
+    QMutex mutex;
+    QStringList found;   // drained on the GUI thread by flushScan()
+    QStringList held;    // with dedup: everything, until the walk is done
+};
 
 static QString relUnder(const QString& root, const QString& absDir) {
     if (root.isEmpty()) return QString();
@@ -10,29 +124,68 @@ static QString relUnder(const QString& root, const QString& absDir) {
     return rel;
 }
 
+BatchScanner::BatchScanner(QObject* parent) : QObject(parent) {
+    // Directory walking is dominated by I/O latency on network shares, so run
+    // more walkers than cores.
+    m_pool.setMaxThreadCount(std::max(4, QThread::idealThreadCount()*2));
+    m_flushTimer.setInterval(100);
+    connect(&m_flushTimer, &QTimer::timeout, this, &BatchScanner::flushScan);
+}
+
+BatchScanner::~BatchScanner() {
+    if (m_scan) m_scan->cancelled = true;
+    m_pool.waitForDone();
+}
+
+// Archive members are judged by the member name
+static QString inputName(const QString& p) {
+    QString member;
+    return Archive::split(p, nullptr, &member) ? member : p;
+}
+
 bool BatchScanner::isCDInput(const QString& p){
-    const auto ext = QFileInfo(p).suffix().toLower();
+    const auto ext = QFileInfo(inputName(p)).suffix().toLower();
     return ext=="cue" || ext=="toc" || ext=="gdi";
 }
 bool BatchScanner::isDVDInput(const QString& p){
-    const auto ext = QFileInfo(p).suffix().toLower();
+    const auto ext = QFileInfo(inputName(p)).suffix().toLower();
     return ext=="iso";
 }
 
+bool BatchScanner::archivesSupported() const { return Archive::supported(); }
+
+// Discs inside an archive, as "archive#member" inputs
+static QStringList archiveInputs(const QString& archive, bool includeCD, bool includeDVD) {
+    QStringList out;
+    for (const auto& m : Archive::list(archive)) {
+        const InputKind kind = classifyName(QFile::encodeName(QFileInfo(m.name).fileName()).constData());
+        if (wanted(kind, includeCD, includeDVD)) out << archive + '#' + m.name;
+    }
+    return out;
+}
+
 QString BatchScanner::defaultOutputFor(const QString& input, JobType t, MediaType m,
-                                       const QString& outRoot, bool preserve, const QString& sourceRoot) {
-    const QFileInfo in(input);
-    const QString base = in.completeBaseName();
+                                       const QString& outRoot, bool preserve, const QString& sourceRoot,
+                                       bool createDirs) {
+    // A disc in an archive is mirrored as if it sat next to the archive
+    QString archive, member;
+    const bool inArchive = Archive::split(input, &archive, &member);
+    const QFileInfo in(inArchive ? archive : input);
+    const QString base = QFileInfo(inArchive ? member : input).completeBaseName();
     QDir out(outRoot);
     if (preserve && !sourceRoot.isEmpty()) {
         const QString rel = relUnder(sourceRoot, in.dir().absolutePath());
-        if (!rel.isEmpty()) { out.mkpath(rel); out.cd(rel); }
+        if (!rel.isEmpty()) {
+            if (createDirs) out.mkpath(rel);
+            out.setPath(out.filePath(rel));
+        }
     }
     switch (t) {
         case JobType::Create:  return out.filePath(base + ".chd");
         case JobType::Extract: return out.filePath((m==MediaType::DVD) ? base + ".iso" : base + ".cue");
         case JobType::Verify:
-        case JobType::Info:    return QString();
+        case JobType::Info:
+        case JobType::DeleteSource: return QString();
     }
     return out.filePath(base + ".chd");
 }
@@ -42,43 +195,202 @@ QList<Job> BatchScanner::scan(const QString& sourceDir, const QString& outRoot,
                               const QStringList& extraArgs, bool deleteSrc,
                               bool preserveStructure) const {
     QList<Job> jobs;
-    QDirIterator it(sourceDir, opt.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
-    while (it.hasNext()){
-        const auto path = it.next();
-        if (!QFileInfo(path).isFile()) continue;
-        const bool cd  = isCDInput(path);
-        const bool dvd = isDVDInput(path);
-        if ((cd && opt.includeCD) || (dvd && opt.includeDVD)) {
-            Job j;
-            j.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
-            j.type = jobType;
-            j.media = dvd ? MediaType::DVD : MediaType::CD;
-            j.inputPath = path;
-            j.outputPath = defaultOutputFor(path, jobType, j.media, outRoot, preserveStructure, sourceDir);
-            j.extraArgs = extraArgs;
-            j.deleteSourceAfter = deleteSrc;
-            j.preserveStructure = preserveStructure;
-            jobs << j;
-        }
-    }
+    walkSync(sourceDir, opt.recursive, [&](const QByteArray& p, InputKind kind){
+        if (!wanted(kind, opt.includeCD, opt.includeDVD)) return;
+        const QString path = QFile::decodeName(p);
+        Job j;
+        j.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        j.type = jobType;
+        j.media = (kind==InputKind::DVD) ? MediaType::DVD : MediaType::CD;
+        j.inputPath = path;
+        j.outputPath = defaultOutputFor(path, jobType, j.media, outRoot, preserveStructure, sourceDir);
+        j.extraArgs = extraArgs;
+        j.deleteSourceAfter = deleteSrc;
+        j.preserveStructure = preserveStructure;
+        jobs << j;
+    });
     return jobs;
 }
 
-QStringList BatchScanner::findInputs(QString sourceDir, bool recursive, bool includeCD, bool includeDVD) const {
+QStringList BatchScanner::archiveInputs(QString archive, bool includeCD, bool includeDVD) const {
+    return ::archiveInputs(localPath(archive), includeCD, includeDVD);
+}
+
+QStringList BatchScanner::findInputs(QString sourceDir, bool recursive, bool includeCD, bool includeDVD,
+                                     bool includeArchives) const {
     QStringList out;
-    QDirIterator it(sourceDir, recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
-    while (it.hasNext()){
-        auto p = it.next();
-        if (!QFileInfo(p).isFile()) continue;
-        const bool cd  = isCDInput(p);
-        const bool dvd = isDVDInput(p);
-        if ((cd && includeCD) || (dvd && includeDVD))
-            out << p;
-    }
+    const bool archives = includeArchives && Archive::supported();
+    walkSync(sourceDir, recursive, [&](const QByteArray& p, InputKind kind){
+        if (wanted(kind, includeCD, includeDVD)) out << QFile::decodeName(p);
+        else if (kind==InputKind::Archive && archives) out << archiveInputs(QFile::decodeName(p), includeCD, includeDVD);
+    });
     return out;
 }
 
-QString BatchScanner::defaultOutputForInvokable(QString input, int jobType, int media, QString outRoot, bool preserve) const {
+void BatchScanner::startScan(QString sourceDir, bool recursive, bool includeCD, bool includeDVD,
+                             QString outRoot, int jobType, bool preserve, bool skipUpToDate, bool dedup,
+                             bool includeArchives) {
+    cancelScan();
+    auto s = std::make_shared<ScanState>();
+    s->owner = this; s->pool = &m_pool;
+    s->recursive = recursive; s->includeCD = includeCD; s->includeDVD = includeDVD;
+    s->jobType = static_cast<JobType>(jobType);
+    s->skipUpToDate = skipUpToDate && (s->jobType==JobType::Create || s->jobType==JobType::Extract);
+    s->outRoot = localPath(outRoot); s->sourceRoot = localPath(sourceDir); s->preserve = preserve;
+    s->dedup = dedup;
+    s->includeArchives = includeArchives && Archive::supported();
+    if (!m_cache.file().isEmpty()) { m_cache.load(); s->cache = &m_cache; }
+    s->pending = 1;
+    m_scan = s;
+    emit scanningChanged();
+    m_flushTimer.start();
+    const QByteArray root = localDirName(sourceDir);
+    m_pool.start([s, root]{ walkSubtree(s, root); });
+}
+
+void BatchScanner::cancelScan() {
+    if (!m_scan) return;
+    m_scan->cancelled = true;   // queued subtrees drain without touching disk
+    if (m_scan->cache) m_scan->cache->save();
+    m_scan.reset();
+    m_flushTimer.stop();
+    emit scanningChanged();
+    emit scanFinished(true);
+}
+
+// A candidate is up to date when its default output exists and is at least
+// as new as the input and every track file it references. Rewriting a .bin
+// leaves its .cue alone, so the tracks are stat'ed on every pass, but only
+// once the output has passed the cheaper checks.
+static bool outputUpToDate(const QString& out, const QString& input, qint64 inputMtime) {
+    struct stat st;
+    if (out.isEmpty() || stat(QFile::encodeName(out).constData(), &st)!=0) return false;
+    if (!S_ISREG(st.st_mode) || st.st_size==0 || mtimeNs(st)<inputMtime) return false;
+    for (const auto& track : SizeUtil::trackFiles(input)) {
+        struct stat tst;
+        if (track==input) continue;
+        if (stat(QFile::encodeName(track).constData(), &tst)!=0 || mtimeNs(tst)>mtimeNs(st)) return false;
+    }
+    return true;
+}
+
+void BatchScanner::walkSubtree(const std::shared_ptr<ScanState>& s, const QByteArray& dir) {
+    struct stat dst;
+    if (!s->cancelled && stat(dir.constData(), &dst)==0) {
+        const qint64 dirMtime = mtimeNs(dst);
+        std::optional<ScanCache::Dir> cached = s->cache ? s->cache->lookup(dir, dirMtime) : std::nullopt;
+        ScanCache::Dir entry;
+        int n = 0;
+        if (cached) {
+            entry = std::move(*cached);
+            n = entry.files;
+        } else {
+            entry.mtime = dirMtime;
+            n = listDir(dir,
+                [&](const char* name, InputKind kind){
+                    entry.inputs << ScanCache::Input{ name, 0, 0, quint8(kind) };
+                },
+                [&](const char* name){ entry.subdirs << name; });
+            entry.files = n;
+        }
+        if (s->recursive) {
+            for (const auto& sub : entry.subdirs) {
+                if (s->cancelled) break;
+                ++s->pending;
+                s->pool->start([s, path=joinPath(dir, sub)]{ walkSubtree(s, path); });
+            }
+        }
+
+        QStringList local;
+        int skipped = 0;
+        bool refreshed = !cached;
+        for (auto& in : entry.inputs) {
+            const auto kind = static_cast<InputKind>(in.kind);
+            const bool archive = kind==InputKind::Archive && s->includeArchives;
+            if (!archive && !wanted(kind, s->includeCD, s->includeDVD)) continue;
+            const QByteArray path = joinPath(dir, in.name);
+            const QString file = QFile::decodeName(path);
+            // Archives are opened for their headers only; members share the archive's mtime
+            const QStringList inputs = archive ? archiveInputs(file, s->includeCD, s->includeDVD) : QStringList{ file };
+            if (inputs.isEmpty()) continue;
+            if (s->skipUpToDate) {
+                struct stat ist;
+                if (stat(path.constData(), &ist)!=0) continue;
+                if (in.mtime!=mtimeNs(ist) || in.size!=qint64(ist.st_size)) {
+                    in.mtime = mtimeNs(ist); in.size = ist.st_size; refreshed = true;
+                }
+                for (const auto& input : inputs) {
+                    const auto media = isDVDInput(input) ? MediaType::DVD : MediaType::CD;
+                    const QString out = defaultOutputFor(input, s->jobType, media, s->outRoot,
+                                                         s->preserve, s->sourceRoot, false);
+                    if (outputUpToDate(out, input, in.mtime)) ++skipped;
+                    else local << input;
+                }
+                continue;
+            }
+            local << inputs;
+        }
+        if (s->cache && refreshed) s->cache->store(dir, std::move(entry));
+
+        ++s->dirs; s->files += n; s->matched += local.size(); s->skipped += skipped;
+        if (!local.isEmpty()) { QMutexLocker lock(&s->mutex); (s->dedup ? s->held : s->found) << local; }
+    }
+    if (--s->pending == 0) {
+        BatchScanner* owner = s->owner;
+        QMetaObject::invokeMethod(owner, [owner, s]{ owner->finishScan(s); }, Qt::QueuedConnection);
+    }
+}
+
+void BatchScanner::flushScan() {
+    if (!m_scan) return;
+    QStringList batch;
+    { QMutexLocker lock(&m_scan->mutex); batch.swap(m_scan->found); }
+    if (!batch.isEmpty()) emit inputsFound(batch);
+    emit scanProgress(m_scan->dirs, m_scan->files, m_scan->matched, m_scan->skipped);
+}
+
+void BatchScanner::finishScan(const std::shared_ptr<ScanState>& s) {
+    if (s!=m_scan) return;   // cancelled or superseded
+    flushScan();
+    if (s->cache) {
+        s->cache->prune(localDirName(s->sourceRoot), s->recursive);
+        s->cache->save();
+    }
+    if (!s->dedup || s->held.isEmpty()) { completeScan(); return; }
+
+    // The walk is over, so the held list is no longer shared with workers.
+    // Parallel walkers hand in their finds in any order; path order makes the
+    // primary of each group the same from one scan to the next.
+    m_pool.start([this, s]{
+        std::sort(s->held.begin(), s->held.end());
+        Dedup::Stats stats;
+        const auto groups = Dedup::findDuplicates(s->held, &s->cancelled, &stats);
+        QMetaObject::invokeMethod(this, [this, s, groups, stats]{
+            if (s!=m_scan) return;
+            QSet<QString> dropped;
+            for (const auto& g : groups) {
+                emit duplicatesFound(g.primary, g.duplicates);
+                for (const auto& d : g.duplicates) dropped.insert(d);
+            }
+            QStringList unique;
+            for (const auto& in : std::as_const(s->held)) if (!dropped.contains(in)) unique << in;
+            s->held.clear();
+            emit dedupFinished(stats.inputs, qint64(stats.bytesHashed), stats.msec);
+            if (!unique.isEmpty()) emit inputsFound(unique);
+            completeScan();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void BatchScanner::completeScan() {
+    m_flushTimer.stop();
+    m_scan.reset();
+    emit scanningChanged();
+    emit scanFinished(false);
+}
+
+QString BatchScanner::defaultOutputForInvokable(QString input, int jobType, int media, QString outRoot, bool preserve,
+                                                QString sourceRoot) const {
     return defaultOutputFor(input, static_cast<JobType>(jobType),
-                            static_cast<MediaType>(media), outRoot, preserve);
+                            static_cast<MediaType>(media), localPath(outRoot), preserve, localPath(sourceRoot));
 }
@@ -1,10 +1,16 @@
 #pragma once
 #include "Job.hpp"
+#include "ScanCache.hpp"
 #include <QObject>
 #include <QDirIterator>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
 
 class BatchScanner : public QObject {
     Q_OBJECT
+    Q_PROPERTY(bool scanning READ scanning NOTIFY scanningChanged)
+    Q_PROPERTY(bool archivesSupported READ archivesSupported CONSTANT)
 public:
     struct Options {
         bool recursive = true;
@@ -12,20 +18,64 @@ public:
         bool includeDVD = true;    // .iso
         QString sourceRoot;        // used for mirroring
     };
-    explicit BatchScanner(QObject* parent=nullptr):QObject(parent){}
+    explicit BatchScanner(QObject* parent=nullptr);
+    ~BatchScanner() override;
 
     QList<Job> scan(const QString& sourceDir, const QString& outRoot,
                     JobType jobType, const Options& opt,
                     const QStringList& extraArgs, bool deleteSrc,
                     bool preserveStructure) const;
 
+    // Asynchronous scan: each directory is walked as its own task on a worker
+    // pool and matches are streamed back in batches via inputsFound().
+    // With skipUpToDate, inputs whose default output already exists and is
+    // newer than the input are dropped; unchanged directories are replayed
+    // from the scan index instead of being read again.
+    // With dedup, matches are held until the walk ends; byte-identical inputs
+    // are then reported through duplicatesFound() and only the first copy of
+    // each goes out through inputsFound().
+    // With includeArchives, discs inside .zip/.7z/.rar files are reported as
+    // "archive#member" inputs (needs a libarchive build).
+    Q_INVOKABLE void startScan(QString sourceDir, bool recursive, bool includeCD, bool includeDVD,
+                               QString outRoot = QString(), int jobType = 0,
+                               bool preserve = true, bool skipUpToDate = false, bool dedup = false,
+                               bool includeArchives = false);
+    Q_INVOKABLE void cancelScan();
+    bool scanning() const { return m_scan != nullptr; }
+    bool archivesSupported() const;
+
+    void setCacheFile(const QString& file) { m_cache.setFile(file); }
+
     // QML helpers
-    Q_INVOKABLE QStringList findInputs(QString sourceDir, bool recursive, bool includeCD, bool includeDVD) const;
-    Q_INVOKABLE QString defaultOutputForInvokable(QString input, int jobType, int media, QString outRoot, bool preserve) const;
+    Q_INVOKABLE QStringList findInputs(QString sourceDir, bool recursive, bool includeCD, bool includeDVD,
+                                       bool includeArchives = false) const;
+    Q_INVOKABLE QStringList archiveInputs(QString archive, bool includeCD, bool includeDVD) const;
+    Q_INVOKABLE QString defaultOutputForInvokable(QString input, int jobType, int media, QString outRoot, bool preserve,
+                                                  QString sourceRoot = QString()) const;
+
+signals:
+    void scanningChanged();
+    void inputsFound(const QStringList& inputs);
+    void duplicatesFound(const QString& primary, const QStringList& duplicates);   // before primary's inputsFound()
+    void dedupFinished(int inputs, qint64 bytesHashed, qint64 msec);
+    void scanProgress(int dirs, int files, int matched, int skipped);
+    void scanFinished(bool cancelled);
 
 private:
+    struct ScanState;
+    std::shared_ptr<ScanState> m_scan;
+    QThreadPool m_pool;
+    QTimer m_flushTimer;
+    ScanCache m_cache;
+
+    void flushScan();
+    void finishScan(const std::shared_ptr<ScanState>& s);
+    void completeScan();
+    static void walkSubtree(const std::shared_ptr<ScanState>& s, const QByteArray& dir);
+
     static bool isCDInput(const QString& path);
     static bool isDVDInput(const QString& path);
     static QString defaultOutputFor(const QString& input, JobType t, MediaType m,
-                                    const QString& outRoot, bool preserve, const QString& sourceRoot=QString());
+                                    const QString& outRoot, bool preserve, const QString& sourceRoot=QString(),
+                                    bool createDirs=true);
 };
@@ -0,0 +1,166 @@
+#include "ChdInfo.hpp"
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+using namespace ChdInfo;
+
+static constexpr char kTag[8] = {'M','C','o','m','p','r','H','D'};
+static constexpr int kMaxMetadata = 4096;   // guards against looping chains
+
+static quint32 be32(const uchar* p) { return qFromBigEndian<quint32>(p); }
+static quint64 be64(const uchar* p) { return qFromBigEndian<quint64>(p); }
+
+static QString fourcc(quint32 v) {
+    QString s;
+    for (int shift=24; shift>=0; shift-=8) s += QChar(char((v>>shift) & 0xff));
+    return s;
+}
+
+static QByteArray hexOrEmpty(const uchar* p, int n) {
+    for (int i=0;i<n;++i) if (p[i]) return QByteArray(reinterpret_cast<const char*>(p), n).toHex();
+    return QByteArray();
+}
+
+// v3/v4 used a single compression enum instead of per-slot codecs
+static QString legacyCompression(quint32 c) {
+    switch (c) {
+        case 0: return "none";
+        case 1: return "zlib";
+        case 2: return "zlib+";
+        case 3: return "avhu";
+    }
+    return QString("unknown(%1)").arg(c);
+}
+
+Header ChdInfo::read(const QString& path) {
+    Header h;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) { h.error = f.errorString(); return h; }
+    h.fileBytes = quint64(f.size());
+    if (f.size() < 16) { h.error = "file too small"; return h; }
+    const uchar* p = f.map(0, std::min<qint64>(f.size(), 124));
+    if (!p) { h.error = "cannot map header"; return h; }
+    if (memcmp(p, kTag, 8)!=0) { h.error = "not a CHD file"; return h; }
+    const quint32 length = be32(p+8);
+    h.version = be32(p+12);
+    quint64 metaOffset = 0;
+
+    if (h.version==5 && length>=124 && f.size()>=124) {
+        for (int i=0;i<4;++i) {
+            const quint32 c = be32(p+16+4*i);
+            if (c) h.compressors << fourcc(c);
+        }
+        h.logicalBytes = be64(p+32);
+        metaOffset     = be64(p+48);
+        h.hunkBytes    = be32(p+56);
+        h.unitBytes    = be32(p+60);
+        h.rawSha1      = hexOrEmpty(p+64, 20);
+        h.sha1         = hexOrEmpty(p+84, 20);
+        h.parentSha1   = hexOrEmpty(p+104, 20);
+    } else if (h.version==4 && length>=108 && f.size()>=108) {
+        h.compressors << legacyCompression(be32(p+20));
+        h.totalHunks   = be32(p+24);
+        h.logicalBytes = be64(p+28);
+        metaOffset     = be64(p+36);
+        h.hunkBytes    = be32(p+44);
+        h.sha1         = hexOrEmpty(p+48, 20);
+        h.parentSha1   = hexOrEmpty(p+68, 20);
+        h.rawSha1      = hexOrEmpty(p+88, 20);
+    } else if (h.version==3 && length>=120 && f.size()>=120) {
+        h.compressors << legacyCompression(be32(p+20));
+        h.totalHunks   = be32(p+24);
+        h.logicalBytes = be64(p+28);
+        metaOffset     = be64(p+36);
+        h.hunkBytes    = be32(p+76);
+        h.sha1         = hexOrEmpty(p+80, 20);
+        h.parentSha1   = hexOrEmpty(p+100, 20);
+    } else {
+        h.error = QString("unsupported CHD version %1").arg(h.version);
+        return h;
+    }
+    f.unmap(const_cast<uchar*>(p));
+    if (h.hunkBytes && !h.totalHunks) h.totalHunks = (h.logicalBytes + h.hunkBytes - 1) / h.hunkBytes;
+    if (!h.unitBytes) h.unitBytes = h.hunkBytes;
+
+    // Metadata chain: tag(4) flags(1) length(3) next(8), then data
+    for (int n=0; metaOffset && n<kMaxMetadata; ++n) {
+        if (metaOffset + 16 > quint64(f.size())) { h.error = "metadata offset out of range"; break; }
+        const uchar* m = f.map(qint64(metaOffset), 16);
+        if (!m) break;
+        const quint32 tag = be32(m);
+        const quint32 len = be32(m+4) & 0x00ffffff;
+        const quint64 next = be64(m+8);
+        f.unmap(const_cast<uchar*>(m));
+        Metadata md{ fourcc(tag), QByteArray() };
+        if (len && metaOffset + 16 + len <= quint64(f.size())) {
+            if (const uchar* d = f.map(qint64(metaOffset+16), len)) {
+                md.data = QByteArray(reinterpret_cast<const char*>(d), int(len));
+                f.unmap(const_cast<uchar*>(d));
+                while (md.data.endsWith('\0')) md.data.chop(1);
+            }
+        }
+        h.metadata << md;
+        metaOffset = next;
+    }
+    h.valid = h.error.isEmpty();
+    return h;
+}
+
+QString ChdInfo::mediaKind(const Header& h) {
+    for (const auto& m : h.metadata) {
+        if (m.tag=="CHT2" || m.tag=="CHTR" || m.tag=="CHCD") return "CD";
+        if (m.tag=="CHGT" || m.tag=="CHGD") return "GD-ROM";
+        if (m.tag=="DVD ") return "DVD";
+        if (m.tag=="GDDD") return "HD";
+    }
+    return QString();
+}
+
+static bool isTextTag(const QString& tag) {
+    return tag=="CHT2" || tag=="CHTR" || tag=="CHGT" || tag=="CHGD" || tag=="GDDD";
+}
+
+QVariantMap ChdInfo::toVariant(const Header& h) {
+    QVariantMap m;
+    if (!h.valid) { m.insert("error", h.error); return m; }
+    m.insert("version", h.version);
+    m.insert("media", mediaKind(h));
+    m.insert("logicalBytes", h.logicalBytes);
+    m.insert("fileBytes", h.fileBytes);
+    m.insert("hunkBytes", h.hunkBytes);
+    m.insert("unitBytes", h.unitBytes);
+    m.insert("totalHunks", h.totalHunks);
+    m.insert("compressors", h.compressors);
+    m.insert("sha1", QString::fromLatin1(h.sha1));
+    m.insert("rawSha1", QString::fromLatin1(h.rawSha1));
+    m.insert("parentSha1", QString::fromLatin1(h.parentSha1));
+    QStringList tracks;
+    for (const auto& md : h.metadata)
+        if (isTextTag(md.tag)) tracks << QString::fromLatin1(md.data);
+    m.insert("tracks", tracks);
+    return m;
+}
+
+QStringList ChdInfo::describe(const Header& h) {
+    if (!h.valid) return { "Error: " + h.error };
+    QStringList out;
+    out << QString("File Version:  %1").arg(h.version)
+        << QString("Logical size:  %1 bytes").arg(h.logicalBytes)
+        << QString("Hunk Size:     %1 bytes").arg(h.hunkBytes)
+        << QString("Total Hunks:   %1").arg(h.totalHunks)
+        << QString("Unit Size:     %1 bytes").arg(h.unitBytes)
+        << QString("Compression:   %1").arg(h.compressors.isEmpty() ? "none" : h.compressors.join(", "));
+    if (h.logicalBytes)
+        out << QString("Ratio:         %1%").arg(100.0*double(h.fileBytes)/double(h.logicalBytes), 0, 'f', 1);
+    if (!h.sha1.isEmpty())       out << "SHA1:          " + QString::fromLatin1(h.sha1);
+    if (!h.rawSha1.isEmpty())    out << "Data SHA1:     " + QString::fromLatin1(h.rawSha1);
+    if (!h.parentSha1.isEmpty()) out << "Parent SHA1:   " + QString::fromLatin1(h.parentSha1);
+    for (const auto& md : h.metadata) {
+        const QString text = isTextTag(md.tag) ? QString::fromLatin1(md.data)
+                                               : QString("%1 bytes").arg(md.data.size());
+        out << QString("Metadata:      Tag='%1'  %2").arg(md.tag, text);
+    }
+    return out;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+// Native reader for CHD headers and metadata (v3-v5), used by Info jobs
+// instead of spawning `chdman info`. Only the header and the metadata chain
+// are mapped; hunk data is never touched.
+namespace ChdInfo {
+    struct Metadata { QString tag; QByteArray data; };
+    struct Header {
+        bool valid = false;
+        QString error;
+        quint32 version = 0;
+        quint32 hunkBytes = 0, unitBytes = 0;
+        quint64 logicalBytes = 0, totalHunks = 0;
+        quint64 fileBytes = 0;
+        QStringList compressors;
+        QByteArray sha1, rawSha1, parentSha1;   // hex; empty when absent
+        QList<Metadata> metadata;
+    };
+
+    Header read(const QString& path);
+    // "CD", "GD-ROM", "DVD", "HD" or empty, from the metadata tags
+    QString mediaKind(const Header& h);
+    QVariantMap toVariant(const Header& h);
+    // Human-readable lines, roughly what `chdman info` prints
+    QStringList describe(const Header& h);
+}
@@ -0,0 +1,68 @@
+#include "ChdmanOutput.hpp"
+#include <cctype>
+
+// Number ending right before `end` (exclusive), e.g. "12.5" in "12.5%"
+static double numberBefore(const QByteArray& s, int end) {
+    int b = end;
+    while (b>0 && (std::isdigit(uchar(s[b-1])) || s[b-1]=='.')) --b;
+    if (b==end) return -1;
+    bool ok = false;
+    const double v = QByteArray::fromRawData(s.constData()+b, end-b).toDouble(&ok);
+    return ok ? v : -1;
+}
+
+// Number starting at or after `from`, skipping '=' and blanks
+static double numberAfter(const QByteArray& s, int from) {
+    while (from<s.size() && (s[from]==' ' || s[from]=='=')) ++from;
+    int e = from;
+    while (e<s.size() && (std::isdigit(uchar(s[e])) || s[e]=='.')) ++e;
+    if (e==from) return -1;
+    bool ok = false;
+    const double v = QByteArray::fromRawData(s.constData()+from, e-from).toDouble(&ok);
+    return ok ? v : -1;
+}
+
+// "Compressing, 12.3% complete... (ratio=45.6%)", "Extracting, 5.0% complete...",
+// "Compression complete ... final ratio = 45.6%"
+bool ChdmanOutput::classify(const QByteArray& rec, Event& ev) {
+    const int ratioAt = rec.indexOf("ratio");
+    const double ratio = ratioAt>=0 ? numberAfter(rec, ratioAt+5) : -1;
+    const int pctAt = rec.indexOf("% complete");
+    if (pctAt>0) {
+        ev.kind = Event::Progress;
+        ev.percent = numberBefore(rec, pctAt);
+        ev.ratio = ratio;
+        return ev.percent>=0;
+    }
+    if (ratio>=0 && rec.contains("complete")) {
+        ev.kind = Event::Summary;
+        ev.ratio = ratio;
+        ev.text = QString::fromLocal8Bit(rec);
+        return true;
+    }
+    ev.kind = Event::Line;
+    ev.text = QString::fromLocal8Bit(rec);
+    return true;
+}
+
+void ChdmanOutput::feed(const QByteArray& chunk, QList<Event>& out) {
+    m_partial += chunk;
+    int start = 0;
+    for (int i=0; i<m_partial.size(); ++i) {
+        const char c = m_partial[i];
+        if (c!='\r' && c!='\n') continue;
+        const QByteArray rec = m_partial.mid(start, i-start).trimmed();
+        start = i+1;
+        if (rec.isEmpty()) continue;
+        Event ev;
+        if (classify(rec, ev)) out << ev;
+    }
+    m_partial.remove(0, start);
+}
+
+void ChdmanOutput::finish(QList<Event>& out) {
+    const QByteArray rec = m_partial.trimmed();
+    m_partial.clear();
+    Event ev;
+    if (!rec.isEmpty() && classify(rec, ev)) out << ev;
+}
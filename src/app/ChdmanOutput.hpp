@@ -0,0 +1,27 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Streaming parser for chdman's stdout/stderr. chdman redraws its progress
+// line with '\r', so records are split on both '\r' and '\n'. Progress
+// redraws become typed events instead of log text; everything else is
+// passed through as a log line.
+class ChdmanOutput {
+public:
+    struct Event {
+        enum Kind { Line, Progress, Summary };
+        Kind kind = Line;
+        double percent = -1;   // Progress
+        double ratio = -1;     // Progress/Summary, when chdman reports it
+        QString text;          // Line/Summary
+    };
+
+    void feed(const QByteArray& chunk, QList<Event>& out);
+    // Emits whatever is left once the process has exited
+    void finish(QList<Event>& out);
+
+private:
+    QByteArray m_partial;
+    static bool classify(const QByteArray& rec, Event& ev);
+};
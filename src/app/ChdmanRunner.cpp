@@ -1,7 +1,82 @@
 #include "ChdmanRunner.hpp"
-#include <QRegularExpression>
+#include "Archive.hpp"
+#include "SizeUtil.hpp"
+#include "ChdInfo.hpp"
+#include "ProcStats.hpp"
+#include "WorkerProtocol.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStorageInfo>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QUrl>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 
-ChdmanRunner::ChdmanRunner(QObject* parent) : QObject(parent) {}
+ChdmanRunner::ChdmanRunner(QObject* parent) : QObject(parent) {
+    m_movePool.setMaxThreadCount(1);   // one copy at a time keeps the share's write stream sequential
+    m_unpackPool.setMaxThreadCount(2);
+    m_measurePool.setMaxThreadCount(4);   // stat()s and cue parsing: latency-bound on shares
+    m_deletePool.setMaxThreadCount(1);    // a slow share's unlinks don't hold up info reads
+    m_statsTimer.setInterval(1000);
+    connect(&m_statsTimer, &QTimer::timeout, this, [this]{
+        for (auto& pr : m_running) { sampleStats(pr); emit jobStats(pr.id, pr.stats); }
+    });
+    connect(&m_remote, &RemoteWorkers::jobStarted, this, &ChdmanRunner::jobStarted);
+    connect(&m_remote, &RemoteWorkers::jobProgress, this, &ChdmanRunner::jobProgress);
+    connect(&m_remote, &RemoteWorkers::jobRatio, this, &ChdmanRunner::jobRatio);
+    connect(&m_remote, &RemoteWorkers::jobLog, this, &ChdmanRunner::jobLog);
+    connect(&m_remote, &RemoteWorkers::jobInfo, this, &ChdmanRunner::jobInfo);
+    connect(&m_remote, &RemoteWorkers::jobStats, this, &ChdmanRunner::jobStats);
+    connect(&m_remote, &RemoteWorkers::jobFinished, this, &ChdmanRunner::remoteFinished);
+    connect(&m_remote, &RemoteWorkers::jobsLost, this, [this](const QStringList& ids){
+        for (const auto& id : ids) {
+            auto r = m_remoteJobs.find(id);
+            if (r==m_remoteJobs.end()) continue;
+            Proc pr = std::move(*r);
+            m_remoteJobs.erase(r);
+            releaseRemoteDevice(pr);
+            if (pr.cancelled) { completeJob(id, false, JobStats{}); continue; }
+            emit jobLog(id, "Worker lost; queued again");
+            m_spaceHeld.remove(id);
+            emit jobRequeued(id);
+            queueInsert(std::move(pr));
+        }
+        maybeStartNext();
+    });
+    // Local and remote jobs alike report through these
+    connect(this, &ChdmanRunner::jobProgress, this, [this](const QString& id, int percent){
+        if (auto h = m_spaceHeld.find(id); h!=m_spaceHeld.end()) h->percent = percent;
+    });
+    connect(this, &ChdmanRunner::jobRatio, this, &ChdmanRunner::ratioKnown);
+    connect(&m_remote, &RemoteWorkers::capacityChanged, this, [this]{
+        emit workersChanged();
+        maybeStartNext();
+    });
+}
+
+// /proc is gone once the process has been reaped, so the final figures are
+// those of the sample taken as chdman's stdout closes (see maybeStartNext).
+void ChdmanRunner::sampleStats(Proc& pr) {
+    const auto s = ProcStats::read(pr.p ? pr.p->processId() : 0);
+    if (s.valid) {
+        pr.stats.userSec = s.userSec; pr.stats.sysSec = s.sysSec;
+        pr.stats.maxRssKb = std::max(pr.stats.maxRssKb, s.maxRssKb);
+        pr.stats.readBytes = s.readBytes; pr.stats.writeBytes = s.writeBytes;
+    }
+    const double secs = pr.clock.elapsed() / 1000.0;
+    const int pct = pr.output ? pr.output->lastPercent : -1;
+    if (secs>0 && pct>0) {
+        pr.stats.mbps = double(pr.bytes) * pct / 100.0 / 1048576.0 / secs;
+        pr.stats.etaSec = int(secs * (100 - pct) / pct);
+    }
+}
 
 void ChdmanRunner::setChdmanPath(const QString& p) {
     if (m_chdmanPath==p) return;
@@ -17,13 +92,448 @@ void ChdmanRunner::setConcurrency(int c) {
     maybeStartNext();
 }
 
+void ChdmanRunner::setQueuePolicy(int policy) {
+    const auto p = static_cast<QueuePolicy>(std::clamp(policy, int(Fifo), int(SmallestFirst)));
+    if (m_policy==p) return;
+    m_policy = p;
+    // Re-key everything under the new policy
+    Queue old;
+    old.swap(m_queue);
+    m_queueKeys.clear();
+    m_byDevice.clear();
+    for (auto& [key, pr] : old) queueInsert(std::move(pr));
+    emit queuePolicyChanged();
+}
+
+void ChdmanRunner::setThreadBudget(int n) {
+    n = std::clamp(n,0,1024);
+    if (m_threadBudget==n) return;
+    m_threadBudget = n;
+    emit threadBudgetChanged();
+}
+
+void ChdmanRunner::setBoostTail(bool on) {
+    if (m_boostTail==on) return;
+    m_boostTail = on;
+    emit boostTailChanged();
+}
+
+void ChdmanRunner::setNativeInfo(bool on) {
+    if (m_nativeInfo==on) return;
+    m_nativeInfo = on;
+    emit nativeInfoChanged();
+}
+
+void ChdmanRunner::setPrefetchDepth(int n) {
+    n = std::clamp(n,0,16);
+    if (m_prefetchDepth==n) return;
+    m_prefetchDepth = n;
+    emit prefetchDepthChanged();
+    schedulePrefetch();
+}
+
+void ChdmanRunner::setPrefetchBudgetMiB(int mib) {
+    mib = std::clamp(mib,0,1<<20);
+    if (prefetchBudgetMiB()==mib) return;
+    m_prefetch.setBudget(quint64(mib) << 20);
+    emit prefetchBudgetChanged();
+    schedulePrefetch();
+}
+
+void ChdmanRunner::setStagingDir(const QString& path) {
+    const QString dir = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;   // from a QML dialog
+    if (m_stagingDir==dir) return;
+    m_stagingDir = dir;
+    emit stagingChanged();
+}
+
+void ChdmanRunner::setStagingBudgetMiB(int mib) {
+    mib = std::max(0, mib);
+    if (stagingBudgetMiB()==mib) return;
+    m_stagingBudget = quint64(mib) << 20;
+    emit stagingChanged();
+}
+
+void ChdmanRunner::setUnpackDir(const QString& path) {
+    const QString dir = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;
+    if (m_unpackDir==dir) return;
+    m_unpackDir = dir;
+    emit unpackChanged();
+}
+
+void ChdmanRunner::setUnpackBudgetMiB(int mib) {
+    mib = std::max(0, mib);
+    if (unpackBudgetMiB()==mib) return;
+    m_unpackBudget = quint64(mib) << 20;
+    emit unpackChanged();
+    scheduleUnpack();
+}
+
+// Unpacks the archived discs of the jobs due to start next: the first
+// `concurrency` of the queue, so scratch use follows concurrency rather than
+// the size of the batch. A disc bigger than the budget still goes through
+// when nothing else is unpacked, one at a time.
+void ChdmanRunner::scheduleUnpack() {
+    int n = 0;
+    for (auto it = m_queue.begin(); it!=m_queue.end() && n<m_concurrency; ++it) {
+        Proc& pr = it->second;
+        if (!Archive::isMember(pr.j.inputPath)) continue;
+        ++n;
+        if (pr.unpacking || !pr.unpackedInput.isEmpty()) continue;
+        if (m_unpackBudget>0 && m_unpackUsed>0 && m_unpackUsed + pr.bytes > m_unpackBudget) break;
+        const QString root = m_unpackDir.isEmpty() ? QDir::tempPath() : m_unpackDir;
+        auto fail = [&](const QString& why){
+            const QString id = pr.id;
+            emit jobLog(id, why);
+            queueTake(it);
+            QMetaObject::invokeMethod(this, [this, id]{ completeJob(id, false, JobStats{}); }, Qt::QueuedConnection);
+            scheduleUnpack();
+        };
+        QStorageInfo fs(root);
+        fs.refresh();
+        if (fs.isValid() && quint64(fs.bytesAvailable()) < pr.bytes) {
+            if (m_unpackUsed>0) break;   // wait for running jobs to give space back
+            fail("Not enough space in " + root + " to unpack " + pr.j.inputPath);
+            return;
+        }
+        // A private directory with an unguessable name: job ids repeat across
+        // CLI runs that may share the unpack dir
+        QTemporaryDir scratch(QDir(root).filePath("opendhc-unpack-XXXXXX"));
+        scratch.setAutoRemove(false);
+        if (!scratch.isValid()) {
+            fail("Cannot create an unpack directory in " + root + ": " + scratch.errorString());
+            return;
+        }
+        pr.unpackBytes = pr.bytes;
+        m_unpackUsed += pr.unpackBytes;
+        pr.unpacking = std::make_shared<std::atomic<bool>>(false);
+        pr.unpackTo = scratch.path();
+        emit jobUnpacking(pr.id, pr.unpackTo);
+        emit jobLog(pr.id, "Unpacking to " + pr.unpackTo);
+        m_unpackPool.start([this, id=pr.id, input=pr.j.inputPath, dir=pr.unpackTo, abandon=pr.unpacking]{
+            QString error;
+            const QString path = Archive::extract(input, dir, &error, abandon.get());
+            if (path.isEmpty()) QDir(dir).removeRecursively();
+            QMetaObject::invokeMethod(this, [this, id, dir, path, error]{ unpackFinished(id, dir, path, error); },
+                                      Qt::QueuedConnection);
+        });
+    }
+}
+
+void ChdmanRunner::unpackFinished(const QString& id, const QString& dir, const QString& path, const QString& error) {
+    auto k = m_queueKeys.constFind(id);
+    if (k==m_queueKeys.constEnd()) {
+        // Cancelled meanwhile; cancel() already gave back the reservation
+        if (!path.isEmpty()) QDir(dir).removeRecursively();
+        return;
+    }
+    auto it = m_queue.find(*k);
+    Proc& pr = it->second;
+    pr.unpacking.reset();
+    if (path.isEmpty()) {
+        const Proc failed = queueTake(it);
+        releaseUnpack(failed);
+        emit jobLog(id, "Unpack failed: " + error);
+        completeJob(id, false, JobStats{});
+    } else {
+        pr.unpackedInput = path;
+    }
+    maybeStartNext();
+}
+
+void ChdmanRunner::releaseUnpack(const Proc& pr) {
+    if (pr.unpackBytes==0) return;
+    if (pr.unpacking) *pr.unpacking = true;   // the unpack task cleans up after itself
+    else QDir(pr.unpackTo).removeRecursively();
+    m_unpackUsed -= std::min(m_unpackUsed, pr.unpackBytes);
+}
+
+void ChdmanRunner::setSpaceMarginMiB(int mib) {
+    mib = std::max(0, mib);
+    if (spaceMarginMiB()==mib) return;
+    m_spaceMargin = quint64(mib) << 20;
+    emit spaceMarginChanged();
+    maybeStartNext();
+}
+
+// Bytes usable by unprivileged writers on the filesystem holding path (or its
+// nearest existing ancestor: outputs usually don't exist yet), or -1
+static qint64 freeSpace(const QString& path) {
+    QString dir = QFileInfo(path).absolutePath();
+    struct statvfs st;
+    while (::statvfs(QFile::encodeName(dir).constData(), &st)!=0) {
+        const QString up = QFileInfo(dir).path();
+        if (errno!=ENOENT || up==dir) return -1;
+        dir = up;
+    }
+    return qint64(st.f_bavail) * qint64(st.f_frsize);
+}
+
+// What a started job has written to its output so far: the file itself, the
+// ".part" of a staged move, or the .bin an extracted .cue names by default
+static quint64 writtenSoFar(const QString& output) {
+    quint64 n = SizeUtil::safeFileSize(output) + SizeUtil::safeFileSize(output + ".part");
+    if (output.endsWith(".cue", Qt::CaseInsensitive))
+        n += SizeUtil::safeFileSize(output.chopped(4) + ".bin");
+    return n;
+}
+
+// Largest output a job can write, from what measure() found: for a create
+// job the input plus chdman's overhead, since a disc may not compress at all;
+// for an extract job the CHD's logical size.
+quint64 ChdmanRunner::predictOutput(const Proc& pr) const {
+    if (pr.j.outputPath.isEmpty() || (pr.j.type!=JobType::Create && pr.j.type!=JobType::Extract)) return 0;
+    if (pr.j.type==JobType::Extract) return std::max(pr.rawBytes, pr.bytes);
+    return std::max<quint64>(1, quint64(double(pr.bytes) * 1.01));
+}
+
+// Whether a job's predicted output fits in what its output filesystem will
+// have left once started jobs finish writing theirs. `room` caches that per
+// filesystem for one pass over the queue. A job that doesn't fit is hopeless
+// when nothing started there can leave more room and pending source deletions
+// wouldn't free enough either.
+bool ChdmanRunner::hasRoom(Proc& pr, QHash<quint64, qint64>& room, bool& hopeless) {
+    hopeless = false;
+    const quint64 need = predictOutput(pr);
+    if (need==0 || pr.devices.isEmpty()) return true;
+    const quint64 fs = pr.devices.last();   // measure() adds the output last
+    auto r = room.find(fs);
+    if (r==room.end()) {
+        const qint64 free = freeSpace(pr.j.outputPath);
+        if (free<0) return true;   // can't tell; let chdman find out
+        qint64 left = free - qint64(m_spaceMargin);
+        for (const auto& h : m_spaceHeld)
+            if (h.fs==fs) left -= qint64(h.bytes - std::min(h.bytes, writtenSoFar(h.output)));
+        r = room.insert(fs, left);
+    }
+    if (*r >= qint64(need)) return true;
+    if (!pr.waitingForSpace) {
+        pr.waitingForSpace = true;
+        emit jobLog(pr.id, QString("Waiting for space: output needs about %1 MB")
+                               .arg(QString::number(need / 1048576.0, 'f', 0)));
+    }
+    if (std::any_of(m_spaceHeld.cbegin(), m_spaceHeld.cend(), [&](const SpaceHold& h){ return h.fs==fs; }))
+        return false;
+    qint64 credit = 0;
+    for (const auto& c : m_credits) if (c.fs==fs) credit += qint64(c.bytes);
+    hopeless = *r + credit < qint64(need);
+    return false;
+}
+
+void ChdmanRunner::holdSpace(const Proc& pr) {
+    if (pr.devices.isEmpty()) return;
+    if (const quint64 need = predictOutput(pr))
+        m_spaceHeld.insert(pr.id, { pr.devices.last(), pr.j.outputPath, need,
+                                    pr.j.type==JobType::Create ? pr.bytes : 0 });
+}
+
+// A create job far enough along to judge its ratio holds that much space, a
+// tenth more for the parts still to come, instead of the worst case
+void ChdmanRunner::ratioKnown(const QString& id, double ratioPct) {
+    auto h = m_spaceHeld.find(id);
+    if (h==m_spaceHeld.end() || h->input==0 || ratioPct<=0 || h->percent<kRatioTrustPct) return;
+    h->bytes = std::max<quint64>(1, quint64(double(h->input) * std::min(1.01, ratioPct / 100.0 * 1.1)));
+}
+
+// Fails a queued job without starting it; it settles on the next turn of the
+// event loop, like any job finishing, so the caller's queue walk stays valid.
+void ChdmanRunner::failQueued(Queue::iterator it, const QString& reason) {
+    const Proc pr = queueTake(it);
+    releaseUnpack(pr);
+    m_prefetch.release(pr.id);
+    emit jobLog(pr.id, reason);
+    QMetaObject::invokeMethod(this, [this, id=pr.id]{ completeJob(id, false, JobStats{}); }, Qt::QueuedConnection);
+}
+
+void ChdmanRunner::setWorkers(const QStringList& addresses) {
+    m_remote.setAddresses(addresses);   // capacityChanged() reports back
+}
+
+// Jobs the local slots can't take yet go out to workers with free slots, in
+// queue order. Discs still in an archive are unpacked locally, so they stay,
+// as do jobs with chdman options workers refuse. A worker reads the same
+// storage, so its job counts against the input's device like a local one.
+// Workers write to the same outputs, so their jobs hold space here too.
+void ChdmanRunner::startRemote() {
+    QHash<quint64, qint64> room;
+    int seen = 0;
+    for (auto it = m_queue.begin(); it!=m_queue.end() && m_remote.freeSlots()>0 && seen<kLookahead; ++seen) {
+        const quint64 dev = it->second.inputDevice;
+        if (Archive::isMember(it->second.j.inputPath) || !WorkerProtocol::allowedArgs(it->second.j.extraArgs)
+            || (dev!=0 && m_deviceBusy.value(dev) >= deviceLimit(dev))) {
+            ++it;
+            continue;
+        }
+        bool hopeless = false;
+        if (!hasRoom(it->second, room, hopeless)) { ++it; continue; }   // nextRunnable() fails hopeless ones
+        const auto following = std::next(it);
+        Proc pr = queueTake(it);
+        it = following;
+        m_prefetch.release(pr.id);
+        Job sent = pr.j;
+        sent.extraArgs << profileArgs(pr.j);   // our profile, not the worker's
+        sent.dependsOn.clear(); sent.pipeline.clear(); sent.linkOutputs.clear();   // settled here
+        if (!m_remote.submit(sent)) { queueInsert(std::move(pr)); break; }
+        emit jobLog(pr.id, "Sent to worker " + m_remote.workerOf(pr.id));
+        if (dev!=0) ++m_deviceBusy[dev];
+        holdSpace(pr);
+        room.clear();   // measure again with this job's share held
+        m_remoteJobs.insert(pr.id, std::move(pr));
+    }
+}
+
+void ChdmanRunner::remoteFinished(const QString& id, bool ok, const JobStats& stats) {
+    auto r = m_remoteJobs.find(id);
+    if (r==m_remoteJobs.end()) return;
+    releaseRemoteDevice(*r);
+    m_remoteJobs.erase(r);
+    completeJob(id, ok, stats);
+    maybeStartNext();
+}
+
+void ChdmanRunner::releaseRemoteDevice(const Proc& pr) {
+    if (pr.inputDevice!=0 && --m_deviceBusy[pr.inputDevice]<=0) m_deviceBusy.remove(pr.inputDevice);
+}
+
+// Reserves room for the output of a create job about to start. The input size
+// is the worst case for a CHD (nothing compressed), so a job that fits can't
+// run out of scratch space.
+void ChdmanRunner::reserveStaging(Proc& pr) {
+    if (m_stagingDir.isEmpty() || pr.j.type!=JobType::Create || pr.j.outputPath.isEmpty()) return;
+    const quint64 need = std::max<quint64>(pr.bytes, 1);
+    if (m_stagingBudget>0 && m_stagingUsed + need > m_stagingBudget) return;
+    QStorageInfo fs(m_stagingDir);
+    fs.refresh();
+    if (!fs.isValid() || quint64(fs.bytesAvailable()) < need) return;
+    const QString dir = QDir(m_stagingDir).filePath("opendhc-" + pr.id);
+    if (!QDir().mkpath(dir)) return;
+    pr.stagedOutput = QDir(dir).filePath(QFileInfo(pr.j.outputPath).fileName());
+    pr.stagedBytes = need;
+    m_stagingUsed += need;
+}
+
+void ChdmanRunner::releaseStaging(const Proc& pr) {
+    if (pr.stagedOutput.isEmpty()) return;
+    m_stagingUsed -= std::min(m_stagingUsed, pr.stagedBytes);
+}
+
+// rename() that fails with EEXIST instead of replacing dst; filesystems
+// without RENAME_NOREPLACE get link() + unlink(), which can't replace either
+static int renameNoReplace(const char* src, const char* dst) {
+    if (::renameat2(AT_FDCWD, src, AT_FDCWD, dst, RENAME_NOREPLACE)==0) return 0;
+    if (errno!=EINVAL && errno!=ENOSYS) return -1;
+    if (::link(src, dst)!=0) return -1;
+    ::unlink(src);
+    return 0;
+}
+
+// Copies into "<to>.part" in the destination directory, syncs it and renames
+// it to the final name, so the destination never shows a partial CHD.
+// Same-filesystem moves are a plain rename. An existing file at <to> is only
+// replaced when overwrite is set (chdman's -f), as chdman itself would.
+bool ChdmanRunner::moveIntoPlace(const QString& from, const QString& to, bool overwrite, QString& error) {
+    const QByteArray src = QFile::encodeName(from), dst = QFile::encodeName(to);
+    auto place = [&](const QByteArray& a){
+        return overwrite ? ::rename(a.constData(), dst.constData()) : renameNoReplace(a.constData(), dst.constData());
+    };
+    auto failed = [&]{
+        error = errno==EEXIST ? QStringLiteral("%1 exists; use -f to overwrite it").arg(to)
+                              : QString::fromLocal8Bit(strerror(errno));
+    };
+    QDir().mkpath(QFileInfo(to).absolutePath());
+    if (place(src)==0) return true;
+    if (errno!=EXDEV) { failed(); return false; }
+    if (!overwrite && QFileInfo::exists(to)) { errno = EEXIST; failed(); return false; }   // before the copy
+
+    const QByteArray part = dst + ".part";
+    const int in = ::open(src.constData(), O_RDONLY | O_CLOEXEC);
+    const int out = in<0 ? -1 : ::open(part.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = in>=0 && out>=0;
+    if (ok) {
+        posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+        constexpr size_t kChunk = 4 << 20;   // large writes: fewer round trips on NFS
+        std::unique_ptr<char[]> buf(new char[kChunk]);
+        for (;;) {
+            const ssize_t n = ::read(in, buf.get(), kChunk);
+            if (n==0) break;
+            if (n<0) { ok = false; break; }
+            for (ssize_t w = 0; w<n; ) {
+                const ssize_t k = ::write(out, buf.get() + w, size_t(n - w));
+                if (k<0) { ok = false; break; }
+                w += k;
+            }
+            if (!ok) break;
+        }
+        ok = ok && ::fsync(out)==0;
+    }
+    if (!ok) error = QString::fromLocal8Bit(strerror(errno));
+    if (out>=0 && ::close(out)!=0 && ok) { ok = false; error = QString::fromLocal8Bit(strerror(errno)); }
+    if (in>=0) ::close(in);
+    if (ok && place(part)!=0) { ok = false; failed(); }
+    if (!ok) ::unlink(part.constData());
+    else ::unlink(src.constData());
+    return ok;
+}
+
+void ChdmanRunner::setPerDeviceLimit(int n) {
+    n = std::clamp(n,0,16);
+    if (m_perDeviceLimit==n) return;
+    m_perDeviceLimit = n;
+    emit perDeviceLimitChanged();
+    maybeStartNext();
+}
+
 bool ChdmanRunner::probeChdman() {
     QProcess p;
     p.start(m_chdmanPath.isEmpty() ? "chdman" : m_chdmanPath, {"-help"});
     return p.waitForFinished(5000) && p.exitStatus()==QProcess::NormalExit;
 }
 
-QStringList ChdmanRunner::buildArgs(const Job& j) const {
+void ChdmanRunner::setCodecProfile(MediaType m, const QString& args) {
+    m_profiles[m==MediaType::DVD ? 1 : 0] = args.split(' ', Qt::SkipEmptyParts);
+}
+
+// Index of a valued option in an argument list, or -1
+static int optionIndex(const QStringList& args, const QString& shortName, const QString& longName) {
+    for (int i=0; i+1<args.size(); ++i)
+        if (args[i]==shortName || args[i]==longName) return i;
+    return -1;
+}
+
+// Threads a job asked for explicitly via -np/--numprocessors, or 0
+static int explicitThreads(const QStringList& extraArgs) {
+    const int i = optionIndex(extraArgs, "-np", "--numprocessors");
+    return i<0 ? 0 : std::max(1, extraArgs[i+1].toInt());
+}
+
+int ChdmanRunner::effectiveBudget() const {
+    return m_threadBudget>0 ? m_threadBudget : std::max(1, QThread::idealThreadCount());
+}
+
+// Share for a create job about to start. Running jobs keep the share they
+// started with (chdman can't be resized), so each job gets an even split of
+// the budget over the process slots, capped by what is still free: a queue
+// that is short for a moment mustn't hand a job threads the next ones need.
+// With boostTail the last jobs of a complete batch take all that's left.
+int ChdmanRunner::threadShare(const Job& j) const {
+    if (j.type!=JobType::Create) return 1;   // only the create verbs accept -np
+    if (int n = explicitThreads(j.extraArgs)) return n;
+    const int budget = effectiveBudget();
+    int used = 0;
+    for (const auto& r : m_running) used += r.threads;
+    const int free = std::max(1, budget - used);
+    if (m_boostTail && !m_inputsPending && m_queue.empty()) {
+        // Nor may a create job still be measured or wait on another step
+        const bool more = std::any_of(m_measuring.cbegin(), m_measuring.cend(),
+                                      [](const Proc& p){ return p.j.type==JobType::Create; })
+                       || std::any_of(m_blocked.cbegin(), m_blocked.cend(),
+                                      [](const Blocked& b){ return b.j.type==JobType::Create; });
+        if (!more) return free;
+    }
+    return std::clamp(budget / std::max(1, m_concurrency), 1, free);
+}
+
+QStringList ChdmanRunner::buildArgs(const Job& j, int threads) const {
     QStringList args;
     switch(j.type){
         case JobType::Create:
@@ -38,19 +548,58 @@ QStringList ChdmanRunner::buildArgs(const Job& j) const {
             args << (j.media==MediaType::DVD ? "extractdvd" : "extractcd")
                  << "-i" << j.inputPath << "-o" << j.outputPath;
             break;
+        case JobType::DeleteSource:
+            break;   // handled in-process, never spawned
     }
-    args << j.extraArgs;
+    args << j.extraArgs << profileArgs(j);
+    if (threads>0 && j.type==JobType::Create && !explicitThreads(j.extraArgs))
+        args << "-np" << QString::number(threads);
     return args;
 }
 
-int ChdmanRunner::parseProgress(const QString& line) {
-    static QRegularExpression re("(\\d{1,3})%");
-    auto m = re.match(line);
-    if (m.hasMatch()) {
-        bool ok=false; int v=m.captured(1).toInt(&ok);
-        if (ok) return std::clamp(v,0,100);
+// The media type's profile, minus the options the job sets itself
+QStringList ChdmanRunner::profileArgs(const Job& j) const {
+    QStringList args;
+    if (j.type!=JobType::Create) return args;
+    const QStringList& profile = m_profiles[j.media==MediaType::DVD ? 1 : 0];
+    for (int i=0; i+1<profile.size(); i+=2) {
+        const bool codecs = profile[i]=="-c" || profile[i]=="--compression";
+        const bool hunk = profile[i]=="-hs" || profile[i]=="--hunksize";
+        if (codecs && optionIndex(j.extraArgs, "-c", "--compression")>=0) continue;
+        if (hunk && optionIndex(j.extraArgs, "-hs", "--hunksize")>=0) continue;
+        args << profile[i] << profile[i+1];
     }
-    return -1;
+    return args;
+}
+
+void ChdmanRunner::dispatchOutput(const QString& id, OutputState& st, const QList<ChdmanOutput::Event>& events) {
+    bool changed = false;
+    for (const auto& ev : events) {
+        switch (ev.kind) {
+            case ChdmanOutput::Event::Line:
+                emit jobLog(id, ev.text);
+                break;
+            case ChdmanOutput::Event::Summary:
+                emit jobLog(id, ev.text);
+                if (ev.ratio>=0) { st.lastRatio = ev.ratio; emit jobRatio(id, ev.ratio); }
+                break;
+            case ChdmanOutput::Event::Progress: {
+                // Keep only the newest redraw; it is published below at most
+                // every kProgressIntervalMs
+                const int p = std::clamp(int(ev.percent),0,100);
+                if (p!=st.lastPercent) { st.lastPercent = p; changed = true; }
+                if (ev.ratio>=0 && ev.ratio!=st.lastRatio) { st.lastRatio = ev.ratio; changed = true; }
+                break;
+            }
+        }
+    }
+    if (changed) st.held = true;
+    if (!st.held) return;
+    if (st.lastEmit.isValid() && st.lastEmit.elapsed() < kProgressIntervalMs) return;
+    st.lastEmit.start();
+    st.held = false;
+    emit jobProgress(id, st.lastPercent);
+    if (st.lastRatio>=0) emit jobRatio(id, st.lastRatio);
 }
 
 void ChdmanRunner::enqueueSimple(QString id, int type, int media, QString input,
@@ -64,58 +613,495 @@ void ChdmanRunner::enqueueSimple(QString id, int type, int media, QString input,
 }
 
 void ChdmanRunner::enqueue(const QString& jobId, const Job& j) {
-    Proc pr{jobId, nullptr, j};
-    m_queue.enqueue(pr);
+    if (!j.pipeline.isEmpty()) {
+        auto& steps = m_pipelines[j.pipeline];
+        auto known = std::find_if(steps.begin(), steps.end(), [&](const Job& s){ return s.id==jobId; });
+        if (known==steps.end()) steps << j; else *known = j;
+        m_pipelineOf.insert(jobId, j.pipeline);
+    }
+    Blocked b{ j };
+    for (const auto& dep : j.dependsOn) {
+        if (m_failed.contains(dep)) {
+            // Settle asynchronously, like any other job finishing
+            QMetaObject::invokeMethod(this, [this, jobId, dep]{
+                emit jobLog(jobId, "Skipped: " + dep + " failed");
+                settle(jobId, false);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        if (m_succeeded.contains(dep)) continue;
+        m_dependents[dep] << jobId;
+        ++b.unmet;
+    }
+    if (b.unmet>0) { m_blocked.insert(jobId, std::move(b)); return; }
+    dispatch(jobId, j);
+}
+
+// Starts a job whose dependencies are met
+void ChdmanRunner::dispatch(const QString& jobId, const Job& j) {
+    if (j.type==JobType::Info && m_nativeInfo) { runNativeInfo(jobId, j.inputPath); return; }
+    if (j.type==JobType::DeleteSource) { runDeleteSource(jobId, j.inputPath); return; }
+    // Sizes and devices take file system round trips; the job queues once
+    // they are known, in its place by arrival all the same
+    Proc pr{jobId, nullptr, j, {}};
+    pr.seq = m_seq++;
+    m_measuring.insert(jobId, std::move(pr));
+    m_measurePool.start([this, jobId, j]{
+        const Measure m = measure(j);
+        QMetaObject::invokeMethod(this, [this, jobId, m]{ measured(jobId, m); }, Qt::QueuedConnection);
+    });
+}
+
+// Devices a job reads from and writes to (both count against per-device
+// limits; the output comes last) and its input size. Runs on the measure pool.
+ChdmanRunner::Measure ChdmanRunner::measure(const Job& j) {
+    Measure m;
+    auto add = [&](const QString& path){
+        const auto d = DeviceUtil::deviceOf(path);
+        if (d.id==0 || std::any_of(m.devices.cbegin(), m.devices.cend(), [&](const DeviceUtil::Device& o){ return o.id==d.id; }))
+            return d.id;
+        m.devices << d;
+        return d.id;
+    };
+    QString archive;
+    m.inputDevice = add(Archive::split(j.inputPath, &archive, nullptr) ? archive : j.inputPath);
+    if (!j.outputPath.isEmpty()) add(j.outputPath);
+    m.bytes = std::max<quint64>(1, SizeUtil::estimateInputBytes(j));
+    m.files = SizeUtil::trackFiles(j.inputPath);
+    for (const auto& f : std::as_const(m.files)) m.fileBytes += quint64(std::max<qint64>(0, QFileInfo(f).size()));
+    if (j.type==JobType::Extract) {
+        const auto h = ChdInfo::read(j.inputPath);
+        if (h.valid) m.rawBytes = h.logicalBytes;
+    }
+    return m;
+}
+
+void ChdmanRunner::measured(const QString& id, const Measure& m) {
+    auto it = m_measuring.find(id);
+    if (it==m_measuring.end()) return;   // cancelled meanwhile
+    Proc pr = std::move(*it);
+    m_measuring.erase(it);
+    for (const auto& d : m.devices) {
+        pr.devices << d.id;
+        m_deviceKinds.insert(d.id, d.kind);
+    }
+    pr.bytes = m.bytes;
+    pr.rawBytes = m.rawBytes;
+    pr.inputDevice = m.inputDevice;
+    pr.inputFiles = m.files;
+    pr.inputFileBytes = m.fileBytes;
+    if (pr.j.pipeline==id && pr.inputDevice!=0 && !Archive::isMember(pr.j.inputPath))
+        m_sources.insert(id, { pr.inputDevice, pr.bytes });   // what its delete step frees
+    queueInsert(std::move(pr));
     maybeStartNext();
 }
 
-void ChdmanRunner::cancel(const QString& jobId) {
+// Reports a finished job and releases or skips the jobs waiting on it
+void ChdmanRunner::settle(const QString& id, bool ok) {
+    emit jobFinished(id, ok);
+    if (auto blocked = m_blocked.constFind(id); blocked!=m_blocked.constEnd()) {
+        // A step skipped before it ran
+        m_blocked.erase(blocked);
+    }
+    m_credits.remove(id);   // a delete step: its space is back, or won't come
+    const QString pipeline = m_pipelineOf.value(id);
+    if (!pipeline.isEmpty()) {
+        (ok ? m_succeeded : m_failed).insert(id);
+        if (ok && id==pipeline) {
+            // The first step is done; its source goes once the rest succeed
+            const auto source = m_sources.constFind(pipeline);
+            if (source!=m_sources.constEnd())
+                for (const auto& s : m_pipelines[pipeline])
+                    if (s.type==JobType::DeleteSource) m_credits.insert(s.id, *source);
+        }
+        const auto& steps = m_pipelines[pipeline];
+        if (std::all_of(steps.begin(), steps.end(), [&](const Job& s){ return m_succeeded.contains(s.id); })) {
+            for (const auto& s : steps) { m_succeeded.remove(s.id); m_pipelineOf.remove(s.id); }
+            m_pipelines.remove(pipeline);
+            m_sources.remove(pipeline);
+            m_cutPipelines.remove(pipeline);
+        }
+    }
+    const bool cut = m_cutPipelines.contains(pipeline);
+    for (const auto& child : m_dependents.take(id)) {
+        auto b = m_blocked.find(child);
+        if (b==m_blocked.end()) continue;
+        if (!ok) {
+            emit jobLog(child, "Skipped: " + id + " failed");
+            settle(child, false);
+        } else if (--b->unmet==0) {
+            const Job j = b->j;
+            m_blocked.erase(b);
+            dispatch(child, j);
+        }
+    }
+    if (cut) forgetPipelineIfIdle(pipeline);
+}
+
+void ChdmanRunner::cancelPipeline(const QString& pipeline) {
+    const auto steps = m_pipelines.value(pipeline);
+    // Later steps first, so nothing gets released while we go. Running steps
+    // settle when their process exits; waiting ones are settled here.
+    for (auto it = steps.crbegin(); it!=steps.crend(); ++it)
+        if (stopJob(it->id)) { emit jobLog(it->id, "Cancelled"); settle(it->id, false); }
+    schedulePrefetch();
+    scheduleUnpack();
+}
+
+bool ChdmanRunner::isActive(const QString& id) const {
+    if (m_blocked.contains(id) || m_measuring.contains(id) || m_queueKeys.contains(id) || m_remoteJobs.contains(id))
+        return true;
+    {
+        QMutexLocker lock(&m_pooledMutex);
+        if (m_pooled.contains(id)) return true;
+    }
+    return std::any_of(m_running.cbegin(), m_running.cend(), [&](const Proc& r){ return r.id==id; });
+}
+
+// A pipeline missing a cancelled step can't run again as a whole; once none
+// of its steps is active, nothing of it is kept
+void ChdmanRunner::forgetPipelineIfIdle(const QString& pipeline) {
+    const auto steps = m_pipelines.value(pipeline);
+    if (std::any_of(steps.cbegin(), steps.cend(), [&](const Job& s){ return isActive(s.id); })) return;
+    for (const auto& s : steps) {
+        m_succeeded.remove(s.id); m_failed.remove(s.id);
+        m_pipelineOf.remove(s.id); m_credits.remove(s.id);
+    }
+    m_pipelines.remove(pipeline);
+    m_sources.remove(pipeline);
+    m_cutPipelines.remove(pipeline);
+}
+
+void ChdmanRunner::retryPipeline(const QString& pipeline) {
+    if (m_cutPipelines.contains(pipeline)) return;
+    const auto steps = m_pipelines.value(pipeline);
+    if (std::any_of(steps.cbegin(), steps.cend(), [&](const Job& s){ return isActive(s.id); })) return;
+    QList<Job> again;
+    for (const auto& s : steps) if (!m_succeeded.contains(s.id)) { m_failed.remove(s.id); again << s; }
+    for (const auto& s : again) { emit jobRequeued(s.id); enqueue(s.id, s); }
+}
+
+// Jobs are measured before they queue, so the size-aware policies have the
+// size at hand.
+ChdmanRunner::QueueKey ChdmanRunner::queueKey(const Proc& pr) const {
+    qint64 order = 0;
+    if (m_policy!=Fifo) order = (m_policy==LargestFirst) ? -qint64(pr.bytes) : qint64(pr.bytes);
+    return { -pr.j.priority, order, pr.seq };
+}
+
+void ChdmanRunner::queueInsert(Proc pr) {
+    const QueueKey key = queueKey(pr);
+    m_queueKeys.insert(pr.id, key);
+    if (pr.devices.isEmpty()) m_byDevice[0].insert(key);
+    for (quint64 d : std::as_const(pr.devices)) m_byDevice[d].insert(key);
+    m_queue.emplace(key, std::move(pr));
+}
+
+ChdmanRunner::Proc ChdmanRunner::queueTake(Queue::iterator it) {
+    const QueueKey key = it->first;
+    Proc pr = std::move(it->second);
+    m_queue.erase(it);
+    m_queueKeys.remove(pr.id);
+    auto unindex = [&](quint64 d){
+        auto i = m_byDevice.find(d);
+        if (i==m_byDevice.end()) return;
+        i->second.erase(key);
+        if (i->second.empty()) m_byDevice.erase(i);
+    };
+    if (pr.devices.isEmpty()) unindex(0);
+    for (quint64 d : std::as_const(pr.devices)) unindex(d);
+    return pr;
+}
+
+void ChdmanRunner::setPriority(const QString& jobId, int priority) {
+    if (auto m = m_measuring.find(jobId); m!=m_measuring.end()) { m->j.priority = priority; return; }
+    auto k = m_queueKeys.constFind(jobId);
+    if (k==m_queueKeys.constEnd()) return;   // not queued (running or unknown)
+    Proc pr = queueTake(m_queue.find(*k));
+    pr.j.priority = priority;
+    queueInsert(std::move(pr));
+    schedulePrefetch();
+    scheduleUnpack();
+}
+
+quint64 ChdmanRunner::inputBytes(const QString& jobId) const {
+    for (const auto& r : m_running) if (r.id==jobId) return r.bytes;
+    const auto r = m_remoteJobs.constFind(jobId);
+    return r!=m_remoteJobs.constEnd() ? r->bytes : 0;
+}
+
+// Kills a running job (it settles when its process exits) or takes a waiting
+// one out of the runner; true if it was waiting
+bool ChdmanRunner::stopJob(const QString& id) {
     for (auto& r : m_running) {
-        if (r.id==jobId && r.p) { r.p->kill(); }
+        if (r.id==id && r.p) { r.p->kill(); }
     }
-    QQueue<Proc> tmp;
-    while(!m_queue.isEmpty()){
-        auto pr = m_queue.dequeue();
-        if (pr.id!=jobId) tmp.enqueue(pr);
+    if (auto r = m_remoteJobs.find(id); r!=m_remoteJobs.end()) {
+        r->cancelled = true;
+        m_remote.cancel(id);   // the worker reports it finished
     }
-    m_queue = std::move(tmp);
+    m_prefetch.release(id);
+    {
+        QMutexLocker lock(&m_pooledMutex);
+        if (m_pooled.remove(id)) return true;   // its task sees this and does nothing
+    }
+    if (auto k = m_queueKeys.constFind(id); k!=m_queueKeys.constEnd()) {
+        releaseUnpack(queueTake(m_queue.find(*k)));
+        return true;
+    }
+    return m_blocked.remove(id) || m_measuring.remove(id);
+}
+
+void ChdmanRunner::cancel(const QString& jobId) {
+    const QString pipeline = m_pipelineOf.value(jobId);
+    if (!pipeline.isEmpty()) m_cutPipelines.insert(pipeline);
+    if (stopJob(jobId)) {
+        // The steps behind it can't run now
+        for (const auto& child : m_dependents.take(jobId)) {
+            if (!m_blocked.contains(child)) continue;
+            emit jobLog(child, "Skipped: " + jobId + " removed");
+            settle(child, false);
+        }
+    }
+    if (!pipeline.isEmpty()) forgetPipelineIfIdle(pipeline);
+    schedulePrefetch();
+    scheduleUnpack();
+}
+
+int ChdmanRunner::deviceLimit(quint64 dev) const {
+    if (m_perDeviceLimit>0) return m_perDeviceLimit;
+    return DeviceUtil::defaultLimit(m_deviceKinds.value(dev), m_concurrency);
+}
+
+// Picks the queued job whose devices are least busy, among those whose
+// devices all have a free slot and whose output fits; the earlier in the
+// queue wins a tie. Each device with a free slot offers the head of its own
+// queue (a window of kLookahead), so a job far down the queue starts as soon
+// as its device frees up even while the jobs ahead wait on another one.
+ChdmanRunner::Queue::iterator ChdmanRunner::nextRunnable() {
+    auto best = m_queue.end();
+    int bestLoad = INT_MAX;
+    QHash<quint64, qint64> room;
+    std::set<QueueKey> tried;   // a job is offered by each of its devices
+    QList<Queue::iterator> hopeless;
+    for (const auto& [dev, keys] : m_byDevice) {
+        if (dev!=0 && m_deviceBusy.value(dev) >= deviceLimit(dev)) continue;
+        int seen = 0;
+        for (auto key = keys.begin(); key!=keys.end() && seen<kLookahead; ++key, ++seen) {
+            if (!tried.insert(*key).second) continue;
+            const auto it = m_queue.find(*key);
+            if (it->second.unpackedInput.isEmpty() && Archive::isMember(it->second.j.inputPath)) continue;
+            int load = 0;
+            bool fits = true;
+            for (quint64 d : it->second.devices) {
+                const int busy = m_deviceBusy.value(d);
+                if (busy >= deviceLimit(d)) { fits = false; break; }
+                load += busy;
+            }
+            if (!fits || load>bestLoad || (load==bestLoad && *key>best->first)) continue;
+            bool never = false;
+            if (!hasRoom(it->second, room, never)) {
+                if (never) hopeless << it;
+                continue;
+            }
+            best = it; bestLoad = load;
+            break;   // later entries of this device only lose the tie
+        }
+    }
+    for (auto it : hopeless)
+        failQueued(it, "Not enough space for the output in " + QFileInfo(it->second.j.outputPath).absolutePath());
+    return best;
 }
 
 void ChdmanRunner::maybeStartNext() {
-    while (m_running.size() < m_concurrency && !m_queue.isEmpty()) {
-        auto pr = m_queue.dequeue();
+    while (m_running.size() < m_concurrency && !m_queue.empty()) {
+        const auto next = nextRunnable();
+        if (next==m_queue.end()) break;   // every queued job waits on a saturated device
+        auto pr = queueTake(next);
+        m_prefetch.release(pr.id);   // chdman's own reads take over
         auto proc = new QProcess(this);
         pr.p = proc;
+        pr.threads = threadShare(pr.j);
+        pr.output = std::make_shared<OutputState>();
+        reserveStaging(pr);
+        holdSpace(pr);
+        pr.clock.start();
+        if (!m_statsTimer.isActive()) m_statsTimer.start();
+        for (quint64 d : pr.devices) ++m_deviceBusy[d];
         m_running << pr;
 
         QString exe = m_chdmanPath.isEmpty() ? "chdman" : m_chdmanPath;
-        auto args = buildArgs(pr.j);
+        Job run = pr.j;
+        if (!pr.stagedOutput.isEmpty()) run.outputPath = pr.stagedOutput;
+        if (!pr.unpackedInput.isEmpty()) run.inputPath = pr.unpackedInput;
+        auto args = buildArgs(run, pr.threads);
 
         emit jobStarted(pr.id);
+        if (!pr.stagedOutput.isEmpty()) emit jobLog(pr.id, "Staging output in " + QFileInfo(pr.stagedOutput).path());
 
-        connect(proc,&QProcess::readyReadStandardOutput,this,[this,proc,id=pr.id]{
-            auto lines = QString::fromLocal8Bit(proc->readAllStandardOutput()).split('\n',Qt::SkipEmptyParts);
-            for (auto& l : lines) {
-                emit jobLog(id, l);
-                int p = parseProgress(l);
-                if (p>=0) emit jobProgress(id, p);
-            }
+        connect(proc,&QProcess::readyReadStandardOutput,this,[this,proc,id=pr.id,st=pr.output]{
+            QList<ChdmanOutput::Event> events;
+            st->out.feed(proc->readAllStandardOutput(), events);
+            dispatchOutput(id, *st, events);
+        });
+        connect(proc,&QProcess::readyReadStandardError,this,[this,proc,id=pr.id,st=pr.output]{
+            QList<ChdmanOutput::Event> events;
+            st->err.feed(proc->readAllStandardError(), events);
+            dispatchOutput(id, *st, events);
         });
-        connect(proc,&QProcess::readyReadStandardError,this,[this,proc,id=pr.id]{
-            auto lines = QString::fromLocal8Bit(proc->readAllStandardError()).split('\n',Qt::SkipEmptyParts);
-            for (auto& l : lines) emit jobLog(id, l);
+        // stdout closes as chdman exits, and QProcess reports that before it
+        // reaps the process: the last chance to read /proc, and the only one
+        // for jobs shorter than the sampling interval
+        connect(proc,&QProcess::readChannelFinished,this,[this,id=pr.id]{
+            for (auto& r : m_running) if (r.id==id) { sampleStats(r); break; }
         });
         connect(proc,qOverload<int,QProcess::ExitStatus>(&QProcess::finished),this,
-                [his,id=pr.id{
-            bool ok = (st==QProcess::NormalExit && code==0);
-            emit jobProgress(id, 100);
-            emit jobFinished(id, ok);
-            for (int i=0;i<m_running.size();++i){
-                if (m_running[i].id==id) { m_running[i].p->deleteLater(); m_running.removeAt(i); break; }
-            }
-            maybeStartNext();
+                [this,proc,id=pr.id,st=pr.output](int code, QProcess::ExitStatus status){
+            QList<ChdmanOutput::Event> events;
+            st->out.feed(proc->readAllStandardOutput(), events);
+            st->err.feed(proc->readAllStandardError(), events);
+            st->out.finish(events);
+            st->err.finish(events);
+            st->lastEmit.invalidate();   // publish what the throttle held back
+            dispatchOutput(id, *st, events);
+            finishRunning(id, status==QProcess::NormalExit && code==0);
         });
+        // A process that never starts emits no finished(). Queued, since start()
+        // may report this synchronously while we are still filling slots.
+        connect(proc,&QProcess::errorOccurred,this,[this,proc,id=pr.id](QProcess::ProcessError e){
+            if (e!=QProcess::FailedToStart) return;
+            emit jobLog(id, proc->errorString());
+            finishRunning(id, false);
+        }, Qt::QueuedConnection);
 
         proc->start(exe, args);
     }
+    startRemote();
+    schedulePrefetch();
+    scheduleUnpack();
+}
+
+// Warms the inputs at the head of the queue. Solid-state inputs don't need
+// it, and on a disk a running job is reading it would only add seeks, so
+// those wait (stopping a read under way) until the disk is idle again.
+void ChdmanRunner::schedulePrefetch() {
+    int n = 0;
+    for (auto it = m_queue.begin(); it!=m_queue.end() && n<m_prefetchDepth; ++it, ++n) {
+        const Proc& pr = it->second;
+        const auto kind = m_deviceKinds.value(pr.inputDevice);
+        if (kind==DeviceUtil::Kind::SolidState) continue;
+        if (kind==DeviceUtil::Kind::Rotational && m_deviceBusy.value(pr.inputDevice)>0) m_prefetch.release(pr.id);
+        else m_prefetch.want(pr.id, pr.inputFiles, pr.inputFileBytes);
+    }
+}
+
+void ChdmanRunner::finishRunning(const QString& id, bool ok) {
+    int i = 0;
+    while (i<m_running.size() && m_running[i].id!=id) ++i;
+    if (i==m_running.size()) return;
+    // Detach first: slots connected to jobFinished may enqueue or cancel
+    Proc pr = m_running.takeAt(i);
+    for (quint64 d : pr.devices)
+        if (--m_deviceBusy[d]<=0) m_deviceBusy.remove(d);
+    if (m_running.isEmpty()) m_statsTimer.stop();
+    releaseUnpack(pr);
+    pr.stats.mbps = pr.clock.elapsed()>0 ? double(pr.bytes) / 1048576.0 / (pr.clock.elapsed()/1000.0) : 0;
+    pr.stats.etaSec = 0;
+    pr.p->deleteLater();
+    if (pr.stagedOutput.isEmpty()) {
+        completeJob(id, ok, pr.stats);
+    } else if (!ok) {
+        QDir(QFileInfo(pr.stagedOutput).path()).removeRecursively();
+        releaseStaging(pr);
+        completeJob(id, false, pr.stats);
+    } else {
+        // The slot is free now; the move overlaps with the next encode
+        emit jobLog(id, "Moving to " + pr.j.outputPath);
+        m_movePool.start([this, pr]{
+            QString error;
+            const bool force = pr.j.extraArgs.contains("-f") || pr.j.extraArgs.contains("--force");
+            const bool moved = moveIntoPlace(pr.stagedOutput, pr.j.outputPath, force, error);
+            if (moved) QDir().rmdir(QFileInfo(pr.stagedOutput).path());
+            QMetaObject::invokeMethod(this, [this, pr, moved, error]{
+                releaseStaging(pr);
+                if (!moved) emit jobLog(pr.id, "Move failed (" + error + "); output kept at " + pr.stagedOutput);
+                completeJob(pr.id, moved, pr.stats);
+                maybeStartNext();   // its space is accounted for now
+            }, Qt::QueuedConnection);
+        });
+    }
+    maybeStartNext();
+}
+
+void ChdmanRunner::completeJob(const QString& id, bool ok, const JobStats& stats) {
+    m_spaceHeld.remove(id);
+    emit jobStats(id, stats);
+    emit jobProgress(id, 100);
+    settle(id, ok);
+}
+
+// Runs a job's work on a pool. It counts as started once a thread picks it
+// up; a job cancelled before that never runs.
+void ChdmanRunner::runPooled(QThreadPool& pool, const QString& id, std::function<void()> work) {
+    {
+        QMutexLocker lock(&m_pooledMutex);
+        m_pooled.insert(id);
+    }
+    pool.start([this, id, work = std::move(work)]{
+        {
+            QMutexLocker lock(&m_pooledMutex);
+            if (!m_pooled.remove(id)) return;
+        }
+        QMetaObject::invokeMethod(this, [this, id]{ emit jobStarted(id); }, Qt::QueuedConnection);
+        work();
+    });
+}
+
+void ChdmanRunner::runNativeInfo(const QString& id, const QString& chdPath) {
+    runPooled(m_infoPool, id, [this, id, chdPath]{
+        const auto h = ChdInfo::read(chdPath);
+        const QStringList lines = ChdInfo::describe(h);
+        const QVariantMap info = ChdInfo::toVariant(h);
+        const bool ok = h.valid;
+        QMetaObject::invokeMethod(this, [this, id, lines, info, ok]{
+            for (const auto& l : lines) emit jobLog(id, l);
+            emit jobInfo(id, info);
+            emit jobProgress(id, 100);
+            settle(id, ok);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Removes an input and the track files it references. Runs after the
+// pipeline's verify step, so the CHD is known to be readable.
+void ChdmanRunner::runDeleteSource(const QString& id, const QString& input) {
+    runPooled(m_deletePool, id, [this, id, input]{
+        QString archive;
+        if (Archive::split(input, &archive, nullptr)) {
+            // Other discs may share the archive; it is left for the user
+            QMetaObject::invokeMethod(this, [this, id, archive]{
+                emit jobLog(id, "Kept archive " + archive);
+                emit jobProgress(id, 100);
+                settle(id, true);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        QStringList files = SizeUtil::trackFiles(input);
+        if (!files.contains(input)) files.prepend(input);
+        QStringList lines;
+        bool ok = true;
+        for (const auto& f : files) {
+            QFile file(f);
+            if (!file.exists()) { lines << "Already gone: " + f; continue; }
+            const bool removed = file.remove();
+            ok = ok && removed;
+            lines << (removed ? "Deleted: " : "Could not delete (" + file.errorString() + "): ") + f;
+        }
+        QMetaObject::invokeMethod(this, [this, id, lines, ok]{
+            for (const auto& l : lines) emit jobLog(id, l);
+            emit jobProgress(id, 100);
+            settle(id, ok);
+            maybeStartNext();   // jobs may have been waiting for this space
+        }, Qt::QueuedConnection);
+    });
 }
@@ -1,14 +1,48 @@
 #pragma once
 #include "Job.hpp"
+#include "DeviceUtil.hpp"
+#include "ChdmanOutput.hpp"
+#include "Prefetcher.hpp"
+#include "RemoteWorkers.hpp"
 #include <QObject>
 #include <QProcess>
-#include <QQueue>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QList>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
 
 class ChdmanRunner : public QObject {
     Q_OBJECT
     Q_PROPERTY(QString chdmanPath READ chdmanPath WRITE setChdmanPath NOTIFY chdmanPathChanged)
     Q_PROPERTY(int concurrency READ concurrency WRITE setConcurrency NOTIFY concurrencyChanged)
+    Q_PROPERTY(int perDeviceLimit READ perDeviceLimit WRITE setPerDeviceLimit NOTIFY perDeviceLimitChanged)
+    Q_PROPERTY(int queuePolicy READ queuePolicy WRITE setQueuePolicy NOTIFY queuePolicyChanged)
+    Q_PROPERTY(int threadBudget READ threadBudget WRITE setThreadBudget NOTIFY threadBudgetChanged)
+    Q_PROPERTY(bool boostTail READ boostTail WRITE setBoostTail NOTIFY boostTailChanged)
+    Q_PROPERTY(bool nativeInfo READ nativeInfo WRITE setNativeInfo NOTIFY nativeInfoChanged)
+    Q_PROPERTY(int prefetchDepth READ prefetchDepth WRITE setPrefetchDepth NOTIFY prefetchDepthChanged)
+    Q_PROPERTY(int prefetchBudgetMiB READ prefetchBudgetMiB WRITE setPrefetchBudgetMiB NOTIFY prefetchBudgetChanged)
+    Q_PROPERTY(QString stagingDir READ stagingDir WRITE setStagingDir NOTIFY stagingChanged)
+    Q_PROPERTY(int stagingBudgetMiB READ stagingBudgetMiB WRITE setStagingBudgetMiB NOTIFY stagingChanged)
+    Q_PROPERTY(QString unpackDir READ unpackDir WRITE setUnpackDir NOTIFY unpackChanged)
+    Q_PROPERTY(int unpackBudgetMiB READ unpackBudgetMiB WRITE setUnpackBudgetMiB NOTIFY unpackChanged)
+    Q_PROPERTY(QStringList workers READ workers WRITE setWorkers NOTIFY workersChanged)
+    Q_PROPERTY(int remoteSlots READ remoteSlots NOTIFY workersChanged)
+    Q_PROPERTY(int spaceMarginMiB READ spaceMarginMiB WRITE setSpaceMarginMiB NOTIFY spaceMarginChanged)
 public:
+    // Order in which queued jobs of equal priority are started
+    enum QueuePolicy { Fifo, LargestFirst, SmallestFirst };
+    Q_ENUM(QueuePolicy)
+
     explicit ChdmanRunner(QObject* parent=nullptr);
 
     QString chdmanPath() const { return m_chdmanPath; }
@@ -17,29 +51,258 @@ public:
     int concurrency() const { return m_concurrency; }
     void setConcurrency(int c);
 
+    // Jobs allowed per storage device; 0 picks a limit from the device kind
+    int perDeviceLimit() const { return m_perDeviceLimit; }
+    void setPerDeviceLimit(int n);
+
+    int queuePolicy() const { return m_policy; }
+    void setQueuePolicy(int policy);
+
+    // Compressor threads shared by all running create jobs (-np);
+    // 0 means one per logical CPU.
+    int threadBudget() const { return m_threadBudget; }
+    void setThreadBudget(int n);
+    // Once the batch is complete and its queue drained, the last jobs to
+    // start take every free thread
+    bool boostTail() const { return m_boostTail; }
+    void setBoostTail(bool on);
+    // A scan or watch may still add jobs, so an empty queue isn't the tail
+    void setInputsPending(bool pending) { m_inputsPending = pending; }
+
+    // Info jobs read the CHD header in-process on a worker pool instead of
+    // spawning `chdman info`; they don't take a process slot.
+    bool nativeInfo() const { return m_nativeInfo; }
+    void setNativeInfo(bool on);
+
+    // Queued jobs (from the head of the queue) whose inputs are read ahead
+    // into the page cache; 0 disables prefetching.
+    int prefetchDepth() const { return m_prefetchDepth; }
+    void setPrefetchDepth(int n);
+    int prefetchBudgetMiB() const { return int(m_prefetch.budget() >> 20); }
+    void setPrefetchBudgetMiB(int mib);
+
+    // Create jobs write to a local scratch directory; a mover then copies the
+    // finished CHD next to its destination and renames it into place, while
+    // the next encode runs. jobFinished() follows the move. Jobs that don't
+    // fit the budget (0 = free space only) write to the destination directly.
+    QString stagingDir() const { return m_stagingDir; }
+    void setStagingDir(const QString& path);
+    int stagingBudgetMiB() const { return int(m_stagingBudget >> 20); }
+    void setStagingBudgetMiB(int mib);
+
+    // Jobs on a disc inside an archive ("archive#member") start once the disc
+    // has been unpacked here (empty = the system temp dir). Only the jobs due
+    // to start next are unpacked, while others run, within the budget
+    // (0 = free space only); each disc is removed when its job ends.
+    QString unpackDir() const { return m_unpackDir; }
+    void setUnpackDir(const QString& path);
+    int unpackBudgetMiB() const { return int(m_unpackBudget >> 20); }
+    void setUnpackBudgetMiB(int mib);
+
+    // opendhc-worker addresses ("host:port" or a socket path). Queued jobs
+    // that don't fit the local slots go to the worker with the most free
+    // slots; workers must see the inputs and outputs under the same paths.
+    // A job whose worker drops out is queued again.
+    QStringList workers() const { return m_remote.addresses(); }
+    void setWorkers(const QStringList& addresses);
+    void setWorkerToken(const QString& token) { m_remote.setToken(token); }
+    int remoteSlots() const { return m_remote.totalSlots(); }
+
+    // Create and extract jobs start only if their predicted output fits on the
+    // output filesystem next to what running jobs have yet to write, leaving
+    // this much free. Jobs that don't fit wait for space; one that can't fit
+    // even with nothing else writing there fails. A create job is admitted
+    // and holds space for the worst case (nothing compressed) until its own
+    // ratio is known.
+    int spaceMarginMiB() const { return int(m_spaceMargin >> 20); }
+    void setSpaceMarginMiB(int mib);
+
+    // Codec/hunk arguments added to create jobs of a media type; options the
+    // job sets itself in extraArgs take precedence.
+    void setCodecProfile(MediaType m, const QString& args);
+
     Q_INVOKABLE bool probeChdman();
     Q_INVOKABLE void enqueue(const QString& jobId, const Job& job);
     Q_INVOKABLE void enqueueSimple(QString id, int type, int media, QString input,
                                    QString output, QStringList extraArgs,
                                    bool deleteSrc, bool preserve);
+    // Stops a job for good: a waiting one leaves the queue and the steps
+    // behind it are skipped; its pipeline can't be retried any more
     Q_INVOKABLE void cancel(const QString& jobId);
+    Q_INVOKABLE void setPriority(const QString& jobId, int priority);
+    // Input size of a started job as measured when it was queued; 0 if unknown
+    quint64 inputBytes(const QString& jobId) const;
+
+    // Pipelines (Job::pipeline / dependsOn): a job waits until every job it
+    // depends on has succeeded and is skipped (finished, not ok) once one
+    // fails. A pipeline is cancelled or retried as a unit; a retry re-runs
+    // the steps that haven't succeeded.
+    Q_INVOKABLE void cancelPipeline(const QString& pipeline);
+    Q_INVOKABLE void retryPipeline(const QString& pipeline);
 
 signals:
     void chdmanPathChanged();
     void concurrencyChanged();
+    void perDeviceLimitChanged();
+    void queuePolicyChanged();
+    void threadBudgetChanged();
+    void boostTailChanged();
+    void nativeInfoChanged();
+    void prefetchDepthChanged();
+    void prefetchBudgetChanged();
+    void stagingChanged();
+    void unpackChanged();
+    void workersChanged();
+    void spaceMarginChanged();
     void jobStarted(const QString& id);
     void jobProgress(const QString& id, int percent);
+    void jobRatio(const QString& id, double ratioPct);   // output size as % of input
     void jobLog(const QString& id, const QString& line);
     void jobFinished(const QString& id, bool ok);
+    void jobRequeued(const QString& id);   // a failed or skipped step queued again by retryPipeline()
+    void jobUnpacking(const QString& id, const QString& dir);   // the job's archived disc goes to dir
+    void jobInfo(const QString& id, const QVariantMap& info);
+    void jobStats(const QString& id, const JobStats& stats);   // ~1 Hz while running, and once at exit
 
 private:
-    struct Proc { QString id; QProcess* p; Job j; };
+    // Parser state for one running process; progress is rate-limited per job
+    struct OutputState {
+        ChdmanOutput out, err;
+        QElapsedTimer lastEmit;
+        int lastPercent = -1;
+        double lastRatio = -1;
+        bool held = false;   // newer values than the last published ones
+    };
+    static constexpr int kProgressIntervalMs = 250;
+
+    struct Proc {
+        QString id; QProcess* p; Job j; QList<quint64> devices;
+        quint64 bytes = 0; quint64 seq = 0;
+        int threads = 1;   // share of the thread budget held while running
+        std::shared_ptr<OutputState> output;
+        QElapsedTimer clock;
+        JobStats stats;
+        QString stagedOutput;      // chdman's -o when staging
+        quint64 stagedBytes = 0;   // staging space reserved
+        QString unpackTo;          // job's unpack directory
+        QString unpackedInput;     // the disc in it, once unpacked
+        quint64 unpackBytes = 0;   // unpack space reserved
+        std::shared_ptr<std::atomic<bool>> unpacking;   // set while unpacking; true = abandon
+        bool cancelled = false;    // remote jobs: cancel sent to the worker
+        quint64 rawBytes = 0;      // extract jobs: the CHD's logical size
+        bool waitingForSpace = false;
+        quint64 inputDevice = 0;
+        QStringList inputFiles;    // what reading the input reads, for prefetching
+        quint64 inputFileBytes = 0;
+    };
+    // What dispatch() learns about a job off the GUI thread before queueing it
+    struct Measure {
+        QList<DeviceUtil::Device> devices;
+        quint64 bytes = 0;
+        quint64 rawBytes = 0;   // extract jobs: the CHD's logical size
+        quint64 inputDevice = 0;
+        QStringList files;      // SizeUtil::trackFiles() of the input
+        quint64 fileBytes = 0;
+    };
+    // Output space held by a started job until its output is in place
+    struct SpaceHold {
+        quint64 fs = 0; QString output; quint64 bytes = 0;
+        quint64 input = 0;   // create jobs: scaled by their ratio once it can be trusted
+        int percent = 0;
+    };
+    static constexpr int kRatioTrustPct = 10;   // progress before a job's ratio sizes its hold
+    static constexpr int kLookahead = 256;      // queue entries a pass considers (per device in nextRunnable())
+    // Space a pipeline's delete step will give back once it runs
+    struct SpaceCredit { quint64 fs = 0; quint64 bytes = 0; };
+    // (-priority, policy order, arrival): std::map keeps the queue sorted
+    using QueueKey = std::tuple<int, qint64, quint64>;
+    using Queue = std::map<QueueKey, Proc>;
+
     QString m_chdmanPath;
     int m_concurrency = 2;
+    int m_perDeviceLimit = 0;
+    QueuePolicy m_policy = Fifo;
+    quint64 m_seq = 0;
+    int m_threadBudget = 0;
+    bool m_boostTail = true;
+    bool m_inputsPending = false;
+    bool m_nativeInfo = true;
+    QStringList m_profiles[2];   // by MediaType
+    int m_prefetchDepth = 2;
+    Prefetcher m_prefetch;
+    QString m_stagingDir;
+    quint64 m_stagingBudget = 0;
+    quint64 m_stagingUsed = 0;     // reserved by running and moving jobs
+    QThreadPool m_movePool;
+    QString m_unpackDir;
+    quint64 m_unpackBudget = 0;
+    quint64 m_unpackUsed = 0;      // reserved by unpacking, queued and running jobs
+    QThreadPool m_unpackPool;
+    quint64 m_spaceMargin = quint64(1024) << 20;
+    QHash<QString, SpaceHold> m_spaceHeld;     // by job
+    QHash<QString, SpaceCredit> m_credits;     // by delete step
+    QHash<QString, SpaceCredit> m_sources;     // by pipeline: its source, as measured
+    RemoteWorkers m_remote;
+    QHash<QString, Proc> m_remoteJobs;   // out on workers, kept to requeue
+    mutable QMutex m_pooledMutex;   // before the pools: their tasks lock it until they are done
+    QSet<QString> m_pooled;   // handed to the info or delete pool, not started yet
+    QThreadPool m_infoPool;
+    QThreadPool m_deletePool;
+    QThreadPool m_measurePool;
+    QHash<QString, Proc> m_measuring;   // dispatched, waiting for measure()
+    QTimer m_statsTimer;
     QList<Proc> m_running;
-    QQueue<Proc> m_queue;
+    Queue m_queue;
+    QHash<QString, QueueKey> m_queueKeys;
+    std::map<quint64, std::set<QueueKey>> m_byDevice;   // device -> its queued jobs; 0 = jobs without one
+    QHash<quint64, DeviceUtil::Kind> m_deviceKinds;
+    QHash<quint64, int> m_deviceBusy;
+    // Dependency tracking
+    struct Blocked { Job j; int unmet = 0; };
+    QHash<QString, Blocked> m_blocked;
+    QHash<QString, QStringList> m_dependents;    // job -> jobs waiting on it
+    QHash<QString, QList<Job>> m_pipelines;      // steps, kept for retry until all succeed
+    QHash<QString, QString> m_pipelineOf;        // step -> pipeline
+    QSet<QString> m_succeeded, m_failed;         // settled pipeline steps
+    QSet<QString> m_cutPipelines;                // a step was cancelled: forgotten once idle
 
-    QStringList buildArgs(const Job& j) const;
+    QStringList buildArgs(const Job& j, int threads = 0) const;
+    QStringList profileArgs(const Job& j) const;
+    void startRemote();
+    void remoteFinished(const QString& id, bool ok, const JobStats& stats);
+    int effectiveBudget() const;
+    int threadShare(const Job& j) const;
+    static Measure measure(const Job& j);
+    void measured(const QString& id, const Measure& m);
+    int deviceLimit(quint64 dev) const;
+    QueueKey queueKey(const Proc& pr) const;
+    void queueInsert(Proc pr);
+    Proc queueTake(Queue::iterator it);
+    Queue::iterator nextRunnable();
+    quint64 predictOutput(const Proc& pr) const;
+    bool hasRoom(Proc& pr, QHash<quint64, qint64>& room, bool& hopeless);
+    void holdSpace(const Proc& pr);
+    void ratioKnown(const QString& id, double ratioPct);
+    void failQueued(Queue::iterator it, const QString& reason);
     void maybeStartNext();
-    static int parseProgress(const QString& line);
+    void schedulePrefetch();
+    void scheduleUnpack();
+    void unpackFinished(const QString& id, const QString& dir, const QString& path, const QString& error);
+    void releaseUnpack(const Proc& pr);
+    void dispatch(const QString& jobId, const Job& j);
+    void settle(const QString& id, bool ok);
+    void releaseRemoteDevice(const Proc& pr);
+    bool stopJob(const QString& id);
+    bool isActive(const QString& id) const;
+    void forgetPipelineIfIdle(const QString& pipeline);
+    void runPooled(QThreadPool& pool, const QString& id, std::function<void()> work);
+    void runNativeInfo(const QString& id, const QString& chdPath);
+    void runDeleteSource(const QString& id, const QString& input);
+    void sampleStats(Proc& pr);
+    void dispatchOutput(const QString& id, OutputState& st, const QList<ChdmanOutput::Event>& events);
+    void finishRunning(const QString& id, bool ok);
+    void reserveStaging(Proc& pr);
+    void releaseStaging(const Proc& pr);
+    void completeJob(const QString& id, bool ok, const JobStats& stats);
+    static bool moveIntoPlace(const QString& from, const QString& to, bool overwrite, QString& error);
 };
@@ -0,0 +1,171 @@
+#include "CodecTuner.hpp"
+#include "SizeUtil.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+
+// chdman's own defaults come first so the baseline is always measured.
+// CD hunks must hold whole 2448-byte frames, DVD hunks whole 2048-byte sectors.
+QList<CodecTuner::Candidate> CodecTuner::candidates(MediaType m) {
+    QList<Candidate> out;
+    if (m==MediaType::CD) {
+        for (const char* c : { "cdlz,cdzl,cdfl", "cdzs,cdzl,cdfl", "cdzl,cdfl", "cdzl" })
+            for (int frames : { 8, 4, 16 }) out << Candidate{ m, c, frames * 2448 };
+    } else {
+        for (const char* c : { "lzma,zlib,huff,flac", "zstd,zlib,huff", "zlib,huff", "zlib" })
+            for (int sectors : { 2, 4, 8 }) out << Candidate{ m, c, sectors * 2048 };
+    }
+    return out;
+}
+
+QString CodecTuner::profileArgs(const Candidate& c) {
+    return QString("-c %1 -hs %2").arg(c.codecs).arg(c.hunkBytes);
+}
+
+QVariantMap CodecTuner::toVariant(const Result& r) {
+    return {
+        {"media", int(r.c.media)}, {"codecs", r.c.codecs}, {"hunkBytes", r.c.hunkBytes},
+        {"args", profileArgs(r.c)}, {"inputBytes", r.inBytes}, {"outputBytes", r.outBytes},
+        {"ratioPct", r.ratioPct()}, {"encodeMbps", r.encodeMbps()}, {"verifyMbps", r.verifyMbps()},
+        {"failures", r.failures},
+    };
+}
+
+void CodecTuner::start(QStringList inputs, int samples, double minMbps) {
+    if (running()) return;
+    m_minMbps = std::max(0.0, minMbps);
+    m_results.clear();
+    m_trials.clear();
+    m_next = 0;
+    m_scratch = std::make_unique<QTemporaryDir>(
+        (m_scratchDir.isEmpty() ? QDir::tempPath() : m_scratchDir) + "/opendhc-tune-XXXXXX");
+    if (!m_scratch->isValid()) { setStatus("Cannot create scratch directory"); emit finished(false); return; }
+
+    for (MediaType m : { MediaType::CD, MediaType::DVD }) {
+        QStringList pool;
+        for (const auto& in : std::as_const(inputs)) {
+            const bool dvd = in.endsWith(".iso", Qt::CaseInsensitive);
+            if (dvd == (m==MediaType::DVD)) pool << in;
+        }
+        if (pool.isEmpty()) continue;
+        // Evenly spaced picks rather than the first few: batches are usually
+        // sorted by name, and neighbours tend to be alike.
+        QList<Trial> picked;
+        const int n = std::clamp(samples, 1, int(pool.size()));
+        for (int i=0; i<n; ++i) {
+            const QString in = pool[int(qint64(i) * pool.size() / n)];
+            Job j; j.inputPath = in;
+            if (const quint64 bytes = SizeUtil::estimateInputBytes(j)) picked << Trial{ 0, in, bytes };
+        }
+        if (picked.isEmpty()) continue;
+        for (const auto& c : candidates(m)) {
+            const int r = int(m_results.size());
+            m_results << Result{ c };
+            for (auto t : std::as_const(picked)) { t.result = r; m_trials << t; }
+        }
+    }
+    if (m_trials.isEmpty()) { setStatus("No usable inputs to tune on"); emit finished(false); return; }
+    m_running = true;
+    emit runningChanged();
+    runNext();
+}
+
+void CodecTuner::cancel() {
+    if (!running()) return;
+    if (m_proc) {
+        m_proc->disconnect(this);
+        m_proc->kill();
+        m_proc->waitForFinished(1000);
+    }
+    stop(true);
+}
+
+void CodecTuner::stop(bool cancelled) {
+    if (m_proc) { m_proc->deleteLater(); m_proc = nullptr; }
+    m_scratch.reset();
+    m_trials.clear();
+    if (cancelled) setStatus("Tuning cancelled");
+    m_running = false;
+    emit runningChanged();
+    emit finished(cancelled);
+}
+
+void CodecTuner::runNext() {
+    if (m_next>=m_trials.size()) { choose(); stop(false); return; }
+    const Trial& t = m_trials[m_next];
+    const Candidate& c = m_results[t.result].c;
+    QStringList args;
+    if (m_verifying) {
+        args << "verify" << "-i" << trialOutput();
+    } else {
+        QFile::remove(trialOutput());
+        args << (c.media==MediaType::DVD ? "createdvd" : "createcd")
+             << "-i" << t.input << "-o" << trialOutput() << "-c" << c.codecs << "-hs" << QString::number(c.hunkBytes);
+    }
+    setStatus(QString("Trial %1/%2: %3 %4 on %5").arg(m_next+1).arg(m_trials.size())
+              .arg(m_verifying ? "verify" : "create", profileArgs(c), QFileInfo(t.input).fileName()));
+
+    if (!m_proc) {
+        m_proc = new QProcess(this);
+        m_proc->setProcessChannelMode(QProcess::MergedChannels);
+        connect(m_proc,qOverload<int,QProcess::ExitStatus>(&QProcess::finished),this,
+                [this](int code, QProcess::ExitStatus status){
+            m_proc->readAll();   // output is not needed, only timing and exit code
+            stepFinished(status==QProcess::NormalExit && code==0);
+        });
+        connect(m_proc,&QProcess::errorOccurred,this,[this](QProcess::ProcessError e){
+            if (e==QProcess::FailedToStart) stepFinished(false);
+        }, Qt::QueuedConnection);
+        connect(m_proc,&QProcess::readyRead,this,[this]{ m_proc->readAll(); });
+    }
+    m_clock.start();
+    m_proc->start(m_chdmanPath.isEmpty() ? "chdman" : m_chdmanPath, args);
+}
+
+void CodecTuner::stepFinished(bool ok) {
+    const double secs = m_clock.elapsed() / 1000.0;
+    const int result = m_trials[m_next].result;
+    const quint64 inBytes = m_trials[m_next].inBytes;
+    Result& r = m_results[result];
+    if (!ok) {
+        // Most likely a codec this chdman doesn't know; its other samples would fail too
+        ++r.failures;
+        m_verifying = false;
+        while (m_next<m_trials.size() && m_trials[m_next].result==result) ++m_next;
+    } else if (!m_verifying) {
+        r.inBytes += inBytes;
+        r.outBytes += quint64(QFileInfo(trialOutput()).size());
+        r.encodeSec += secs;
+        m_verifying = true;
+    } else {
+        r.verifySec += secs;
+        m_verifying = false;
+        ++m_next;
+    }
+    // Report a candidate once its last sample is done
+    if (!m_verifying && (m_next>=m_trials.size() || m_trials[m_next].result!=result))
+        emit trialFinished(toVariant(r));
+    QMetaObject::invokeMethod(this, &CodecTuner::runNext, Qt::QueuedConnection);
+}
+
+// Best ratio among the profiles fast enough; if none is, the fastest one.
+void CodecTuner::choose() {
+    for (MediaType m : { MediaType::CD, MediaType::DVD }) {
+        const Result* best = nullptr;
+        const Result* fastest = nullptr;
+        for (const auto& r : std::as_const(m_results)) {
+            if (r.c.media!=m || r.failures>0 || r.inBytes==0) continue;
+            if (!fastest || r.encodeMbps() > fastest->encodeMbps()) fastest = &r;
+            if (r.encodeMbps() < m_minMbps) continue;
+            if (!best || r.ratioPct() < best->ratioPct()
+                || (r.ratioPct()==best->ratioPct() && r.encodeMbps() > best->encodeMbps())) best = &r;
+        }
+        if (!best) best = fastest;
+        if (!best) continue;
+        QVariantMap v = toVariant(*best);
+        v.insert("metTarget", best->encodeMbps() >= m_minMbps);
+        emit profileChosen(int(m), profileArgs(best->c), v);
+    }
+    setStatus("Tuning finished");
+}
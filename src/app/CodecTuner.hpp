@@ -0,0 +1,76 @@
+#pragma once
+#include "Job.hpp"
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QVariantMap>
+#include <memory>
+
+// Trial-converts a sample of inputs with several codec sets (-c) and hunk
+// sizes (-hs), timing both the create and a verify of the result, and picks
+// per media type the profile with the best ratio that still encodes at the
+// requested speed. Trials run one at a time so their timings are comparable.
+class CodecTuner : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(QString status READ status NOTIFY statusChanged)
+public:
+    struct Candidate { MediaType media; QString codecs; int hunkBytes; };
+    struct Result {
+        Candidate c;
+        quint64 inBytes = 0, outBytes = 0;
+        double encodeSec = 0, verifySec = 0;
+        int failures = 0;
+        double ratioPct() const { return inBytes ? 100.0 * double(outBytes) / double(inBytes) : 100.0; }
+        double encodeMbps() const { return encodeSec>0 ? double(inBytes) / 1048576.0 / encodeSec : 0; }
+        double verifyMbps() const { return verifySec>0 ? double(inBytes) / 1048576.0 / verifySec : 0; }
+    };
+
+    explicit CodecTuner(QObject* parent=nullptr) : QObject(parent) {}
+
+    void setChdmanPath(const QString& p) { m_chdmanPath = p; }
+    // Where trial outputs go; empty uses the system temp dir. Pick a local disk.
+    void setScratchDir(const QString& dir) { m_scratchDir = dir; }
+
+    static QList<Candidate> candidates(MediaType m);
+    // Extra args for a profile, in the form stored in Settings
+    static QString profileArgs(const Candidate& c);
+
+    bool running() const { return m_running; }
+    QString status() const { return m_status; }
+
+    // Up to `samples` inputs per media type are picked evenly across `inputs`.
+    // minMbps is the encode speed (input MiB/s) a profile must reach; 0 = best ratio.
+    Q_INVOKABLE void start(QStringList inputs, int samples = 3, double minMbps = 0);
+    Q_INVOKABLE void cancel();
+
+signals:
+    void runningChanged();
+    void statusChanged();
+    void trialFinished(const QVariantMap& result);
+    void profileChosen(int media, const QString& args, const QVariantMap& result);
+    void finished(bool cancelled);
+
+private:
+    struct Trial { int result; QString input; quint64 inBytes; };
+    QString m_chdmanPath, m_scratchDir, m_status;
+    double m_minMbps = 0;
+    std::unique_ptr<QTemporaryDir> m_scratch;
+    QList<Result> m_results;
+    QList<Trial> m_trials;
+    int m_next = 0;
+    bool m_verifying = false;
+    bool m_running = false;   // from start() until finished(); m_proc only exists once a trial starts
+    QProcess* m_proc = nullptr;
+    QElapsedTimer m_clock;
+
+    QString trialOutput() const { return m_scratch->filePath("trial.chd"); }
+    void setStatus(const QString& s) { m_status = s; emit statusChanged(); }
+    void runNext();
+    void stepFinished(bool ok);
+    void choose();
+    void stop(bool cancelled);
+    static QVariantMap toVariant(const Result& r);
+};
@@ -0,0 +1,58 @@
+#include "DatIndex.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+void DatIndex::clear() {
+    m_name.clear(); m_roms.clear();
+    m_bySha1.clear(); m_byCrcSize.clear(); m_byName.clear();
+}
+
+bool DatIndex::load(const QString& path, QString* error) {
+    clear();
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) { if (error) *error = f.errorString(); return false; }
+    QXmlStreamReader xml(&f);
+    QString game;
+    bool inHeader = false;
+    while (!xml.atEnd()) {
+        const auto tok = xml.readNext();
+        if (tok==QXmlStreamReader::EndElement) {
+            if (xml.name()==u"header") inHeader = false;
+            continue;
+        }
+        if (tok!=QXmlStreamReader::StartElement) continue;
+        const auto tag = xml.name();
+        if (tag==u"header") inHeader = true;
+        else if (inHeader && tag==u"name") m_name = xml.readElementText();
+        else if (tag==u"game" || tag==u"machine") game = xml.attributes().value("name").toString();
+        else if (tag==u"rom") {
+            const auto a = xml.attributes();
+            Rom r{ game, a.value("name").toString(), a.value("size").toULongLong(),
+                   quint32(a.value("crc").toUInt(nullptr, 16)) };
+            const int i = int(m_roms.size());
+            const QByteArray sha1 = QByteArray::fromHex(a.value("sha1").toLatin1());
+            if (sha1.size()==20) m_bySha1.insert(sha1, i);
+            else if (!a.value("crc").isEmpty()) m_byCrcSize.insert({ r.crc, r.size }, i);
+            m_byName.insert(QFileInfo(r.name).fileName().toLower(), i);
+            m_roms << std::move(r);
+        }
+    }
+    if (xml.hasError()) {
+        if (error) *error = QString("%1 (line %2)").arg(xml.errorString()).arg(xml.lineNumber());
+        clear();
+        return false;
+    }
+    if (m_name.isEmpty()) m_name = QFileInfo(path).completeBaseName();
+    return true;
+}
+
+void DatIndex::classify(Hasher::FileHash& h) const {
+    if (!h.ok || isEmpty()) return;
+    int i = m_bySha1.value(h.sha1, -1);
+    if (i<0) i = m_byCrcSize.value({ h.crc32, h.size }, -1);
+    if (i>=0) { h.match = Hasher::FileHash::Matched; h.game = m_roms[i].game; return; }
+    i = m_byName.value(QFileInfo(h.file).fileName().toLower(), -1);
+    if (i>=0) { h.match = Hasher::FileHash::Mismatch; h.game = m_roms[i].game; return; }
+    h.match = Hasher::FileHash::Unknown;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "Hasher.hpp"
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <utility>
+
+// Known-good dumps from a Logiqx XML DAT (Redump, No-Intro), indexed for
+// lookups by SHA1, by CRC32+size for DATs without SHA1, and by file name to
+// tell a bad dump of a known rom from a file the DAT doesn't list.
+class DatIndex {
+public:
+    bool load(const QString& path, QString* error = nullptr);
+    void clear();
+    bool isEmpty() const { return m_roms.isEmpty(); }
+    int size() const { return int(m_roms.size()); }
+    QString name() const { return m_name; }
+
+    // Sets h.match and h.game
+    void classify(Hasher::FileHash& h) const;
+
+private:
+    struct Rom { QString game, name; quint64 size = 0; quint32 crc = 0; };
+    QString m_name;
+    QList<Rom> m_roms;
+    QHash<QByteArray, int> m_bySha1;
+    QHash<std::pair<quint32, quint64>, int> m_byCrcSize;
+    QHash<QString, int> m_byName;      // lower-case file name
+};
@@ -0,0 +1,198 @@
+#include "Dedup.hpp"
+#include "Archive.hpp"
+#include "DeviceUtil.hpp"
+#include "SizeUtil.hpp"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+#include <map>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using u64 = quint64;
+
+// XXH64 (public domain reference algorithm); runs at memory bandwidth, so the
+// pass is bound by the disks rather than by hashing.
+namespace {
+constexpr u64 P1 = 11400714785074694791ULL, P2 = 14029467366897019727ULL, P3 = 1609587929392839161ULL,
+              P4 = 9650029242287828579ULL, P5 = 2870177450012600261ULL;
+inline u64 rotl(u64 x, int r) { return (x<<r) | (x>>(64-r)); }
+inline u64 rd64(const uchar* p) { u64 v; std::memcpy(&v, p, 8); return v; }
+inline u64 rd32(const uchar* p) { quint32 v; std::memcpy(&v, p, 4); return v; }
+inline u64 mix(u64 acc, u64 in) { return rotl(acc + in*P2, 31) * P1; }
+inline u64 merge(u64 h, u64 v) { return (h ^ mix(0, v)) * P1 + P4; }
+}
+
+u64 Dedup::xxh64(const uchar* p, size_t len, u64 seed) {
+    const uchar* const end = p + len;
+    u64 h;
+    if (len>=32) {
+        const uchar* const limit = end - 32;
+        u64 v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+        do {
+            v1 = mix(v1, rd64(p)); v2 = mix(v2, rd64(p+8));
+            v3 = mix(v3, rd64(p+16)); v4 = mix(v4, rd64(p+24));
+            p += 32;
+        } while (p<=limit);
+        h = rotl(v1,1) + rotl(v2,7) + rotl(v3,12) + rotl(v4,18);
+        h = merge(h, v1); h = merge(h, v2); h = merge(h, v3); h = merge(h, v4);
+    } else {
+        h = seed + P5;
+    }
+    h += u64(len);
+    for (; p+8<=end; p+=8) h = rotl(h ^ mix(0, rd64(p)), 27) * P1 + P4;
+    if (p+4<=end) { h = rotl(h ^ (rd32(p) * P1), 23) * P2 + P3; p += 4; }
+    for (; p<end; ++p) h = rotl(h ^ (*p * P5), 11) * P1;
+    h ^= h >> 33; h *= P2; h ^= h >> 29; h *= P3; h ^= h >> 32;
+    return h;
+}
+
+namespace {
+constexpr qint64 kEdgeBytes = 64 * 1024;
+
+struct Item {
+    QString input;
+    QStringList files;
+    QList<qint64> sizes;
+    u64 key = 0;        // refined by each stage
+    bool failed = false;
+};
+
+// Head and tail of every track: cheap, and separates most same-size discs
+// (e.g. DVD images that all fill a single-layer disc).
+u64 edgeHash(const Item& it) {
+    u64 h = 0;
+    QByteArray buf;
+    for (int i=0; i<it.files.size(); ++i) {
+        QFile f(it.files[i]);
+        if (!f.open(QIODevice::ReadOnly)) return 0;
+        buf = f.read(kEdgeBytes);
+        if (it.sizes[i] > kEdgeBytes) {
+            f.seek(std::max(kEdgeBytes, it.sizes[i] - kEdgeBytes));
+            buf += f.read(kEdgeBytes);
+        }
+        h = Dedup::xxh64(reinterpret_cast<const uchar*>(buf.constData()), size_t(buf.size()), h);
+    }
+    return h;
+}
+
+u64 fullHash(const Item& it, const std::atomic<bool>* cancelled, u64& bytes) {
+    u64 h = 0;
+    for (const auto& path : it.files) {
+        if (cancelled && *cancelled) return 0;
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) return 0;
+        const qint64 size = f.size();
+        if (size==0) { h = Dedup::xxh64(nullptr, 0, h); continue; }
+        uchar* p = f.map(0, size);
+        if (!p) return 0;
+        madvise(p, size_t(size), MADV_SEQUENTIAL);
+        h = Dedup::xxh64(p, size_t(size), h);
+        f.unmap(p);
+        bytes += u64(size);
+    }
+    return h;
+}
+
+// Runs fn over the items, in parallel across and within solid-state and
+// network devices but strictly one after another on each rotational disk.
+template<class Fn>
+void forEachByDevice(QList<Item*>& items, Fn fn) {
+    std::map<u64, QList<Item*>> serial;
+    QList<Item*> parallel;
+    for (Item* it : items) {
+        const auto d = DeviceUtil::deviceOf(it->files.value(0));
+        if (d.kind==DeviceUtil::Kind::Rotational) serial[d.id] << it;
+        else parallel << it;
+    }
+    QThreadPool pool;
+    pool.setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+    for (auto& [dev, list] : serial) pool.start([&fn, list]{ for (Item* it : list) fn(*it); });
+    for (Item* it : parallel) pool.start([&fn, it]{ fn(*it); });
+    pool.waitForDone();
+}
+
+// Keeps only items sharing their key with another item
+void dropUnique(QList<Item*>& items) {
+    QHash<u64, int> counts;
+    for (Item* it : items) if (!it->failed) ++counts[it->key];
+    items.removeIf([&](Item* it){ return it->failed || counts.value(it->key) < 2; });
+}
+}
+
+QList<Dedup::Group> Dedup::findDuplicates(const QStringList& inputs, const std::atomic<bool>* cancelled, Stats* stats) {
+    QElapsedTimer clock;
+    clock.start();
+    QList<Item> all(inputs.size());
+    QList<Item*> items;
+    for (int i=0; i<inputs.size(); ++i) {
+        Item& it = all[i];
+        it.input = inputs[i];
+        it.files = SizeUtil::trackFiles(inputs[i]);
+        if (Archive::isMember(it.input)) { it.failed = true; items << &it; continue; }   // shares its archive with siblings
+        u64 h = u64(it.files.size());
+        for (const auto& f : std::as_const(it.files)) {
+            const QFileInfo fi(f);
+            if (!fi.isFile()) { it.failed = true; break; }   // unresolved tracks: convert as is
+            it.sizes << fi.size();
+            h = xxh64(reinterpret_cast<const uchar*>(&it.sizes.last()), sizeof(qint64), h);
+        }
+        it.key = h;
+        items << &it;
+    }
+    dropUnique(items);
+
+    std::atomic<u64> bytes{0};
+    std::atomic<int> hashed{0};
+    if (!items.isEmpty() && !(cancelled && *cancelled)) {
+        forEachByDevice(items, [&](Item& it){
+            if (cancelled && *cancelled) return;
+            const u64 h = edgeHash(it);
+            if (!h) it.failed = true;
+            it.key = xxh64(reinterpret_cast<const uchar*>(&h), sizeof h, it.key);
+        });
+        dropUnique(items);
+    }
+    if (!items.isEmpty() && !(cancelled && *cancelled)) {
+        forEachByDevice(items, [&](Item& it){
+            u64 n = 0;
+            const u64 h = fullHash(it, cancelled, n);
+            bytes += n; ++hashed;
+            if (!h) it.failed = true;
+            it.key = xxh64(reinterpret_cast<const uchar*>(&h), sizeof h, it.key);
+        });
+        dropUnique(items);
+    }
+
+    // Groups in input order, so the primary is the copy the user listed first
+    QList<Group> groups;
+    QHash<u64, int> groupOf;
+    if (!(cancelled && *cancelled)) {
+        for (Item* it : std::as_const(items)) {
+            auto g = groupOf.constFind(it->key);
+            if (g==groupOf.constEnd()) {
+                groupOf.insert(it->key, int(groups.size()));
+                u64 size = 0;
+                for (qint64 s : std::as_const(it->sizes)) size += u64(s);
+                groups << Group{ it->input, {}, size };
+            } else {
+                groups[*g].duplicates << it->input;
+            }
+        }
+    }
+    if (stats) *stats = { int(inputs.size()), hashed, bytes, clock.elapsed() };
+    return groups;
+}
+
+bool Dedup::linkOutput(const QString& primaryOut, const QString& dupOut) {
+    if (QFileInfo::exists(dupOut)) return false;
+    QDir().mkpath(QFileInfo(dupOut).absolutePath());
+    if (::link(QFile::encodeName(primaryOut).constData(), QFile::encodeName(dupOut).constData())==0) return true;
+    return QFile::link(QFileInfo(primaryOut).absoluteFilePath(), dupOut);
+}
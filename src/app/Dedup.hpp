@@ -0,0 +1,30 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <atomic>
+
+// Finds byte-identical inputs (same track data, whatever the file names) so
+// each disc is converted once. Inputs are first grouped by their track sizes;
+// only inputs that share sizes are read, first the head and tail of every
+// track and then, for those still alike, the whole data through a memory map.
+namespace Dedup {
+    struct Group {
+        QString primary;         // first of the group in input order; gets converted
+        QStringList duplicates;
+        quint64 bytes = 0;       // track data per copy
+    };
+    struct Stats { int inputs = 0, hashed = 0; quint64 bytesHashed = 0; qint64 msec = 0; };
+
+    // Blocking; call off the GUI thread. Hashing runs in parallel, one reader
+    // at a time per rotational disk.
+    QList<Group> findDuplicates(const QStringList& inputs, const std::atomic<bool>* cancelled = nullptr,
+                                Stats* stats = nullptr);
+
+    // Makes dupOut refer to primaryOut: a hard link when both are on the same
+    // filesystem, a symlink otherwise. An existing dupOut is left alone.
+    bool linkOutput(const QString& primaryOut, const QString& dupOut);
+
+    quint64 xxh64(const uchar* p, size_t len, quint64 seed = 0);
+}
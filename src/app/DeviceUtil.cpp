@@ -0,0 +1,91 @@
+#include "DeviceUtil.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+using namespace DeviceUtil;
+
+static QString readSmall(const QString& path) {
+    QFile f(path);
+    return f.open(QIODevice::ReadOnly) ? QString::fromLatin1(f.readAll()).trimmed() : QString();
+}
+
+// Filesystem type and source for a st_dev, from /proc/self/mountinfo:
+// "id parent maj:min root mountpoint opts [optional...] - fstype source superopts"
+static bool mountFor(dev_t dev, QString& fstype, QString& source) {
+    QFile f("/proc/self/mountinfo");
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    const QByteArray want = QByteArray::number(major(dev)) + ':' + QByteArray::number(minor(dev));
+    while (!f.atEnd()) {
+        const QByteArray line = f.readLine();
+        const QList<QByteArray> parts = line.trimmed().split(' ');
+        if (parts.size()<3 || parts[2]!=want) continue;
+        const int sep = parts.indexOf("-");
+        if (sep<0 || sep+2>=parts.size()) return false;
+        fstype = QString::fromLatin1(parts[sep+1]);
+        source = QString::fromLatin1(parts[sep+2]);
+        return true;
+    }
+    return false;
+}
+
+static Kind blockKind(dev_t dev) {
+    const QString base = QString("/sys/dev/block/%1:%2").arg(major(dev)).arg(minor(dev));
+    // Partitions have no queue/ of their own; it lives on the parent disk
+    QString rot = readSmall(base + "/queue/rotational");
+    if (rot.isEmpty()) rot = readSmall(base + "/../queue/rotational");
+    if (rot=="1") return Kind::Rotational;
+    if (rot=="0") return Kind::SolidState;
+    return Kind::Unknown;
+}
+
+static Kind classify(dev_t dev) {
+    QString fstype, source;
+    if (mountFor(dev, fstype, source)) {
+        static const QStringList net = { "nfs", "nfs4", "cifs", "smb3", "smbfs", "9p", "ceph", "glusterfs" };
+        if (net.contains(fstype) || fstype.startsWith("fuse.sshfs")) return Kind::Network;
+        if (fstype=="tmpfs" || fstype=="ramfs") return Kind::SolidState;
+        // btrfs and friends report an anonymous st_dev; follow the source node
+        struct stat st;
+        if (major(dev)==0 && source.startsWith('/') && ::stat(QFile::encodeName(source).constData(), &st)==0
+            && S_ISBLK(st.st_mode))
+            return blockKind(st.st_rdev);
+    }
+    return major(dev)==0 ? Kind::Unknown : blockKind(dev);
+}
+
+Device DeviceUtil::deviceOf(const QString& path) {
+    static QMutex mutex;
+    static QHash<quint64, Kind> kinds;
+
+    QFileInfo fi(path);
+    QString p = fi.absoluteFilePath();
+    struct stat st;
+    while (::stat(QFile::encodeName(p).constData(), &st)!=0) {
+        const QString parent = QFileInfo(p).absolutePath();
+        if (parent==p) return {};
+        p = parent;
+    }
+    Device d;
+    d.id = quint64(st.st_dev);
+    QMutexLocker lock(&mutex);
+    auto it = kinds.constFind(d.id);
+    if (it==kinds.constEnd()) it = kinds.insert(d.id, classify(st.st_dev));
+    d.kind = *it;
+    return d;
+}
+
+int DeviceUtil::defaultLimit(Kind k, int globalLimit) {
+    switch (k) {
+        case Kind::Rotational: return 1;              // seeks between streams kill throughput
+        case Kind::Network:    return std::min(2, globalLimit);
+        case Kind::SolidState:
+        case Kind::Unknown:    return globalLimit;
+    }
+    return globalLimit;
+}
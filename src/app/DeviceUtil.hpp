@@ -0,0 +1,14 @@
+#pragma once
+#include <QString>
+#include <QtGlobal>
+
+namespace DeviceUtil {
+    enum class Kind { Unknown, Rotational, SolidState, Network };
+    struct Device { quint64 id = 0; Kind kind = Kind::Unknown; };
+
+    // Device backing path, or its nearest existing ancestor (outputs usually
+    // don't exist yet). Kind comes from the mount table and sysfs and is cached.
+    Device deviceOf(const QString& path);
+    // Jobs per device when no explicit limit is set
+    int defaultLimit(Kind k, int globalLimit);
+}
@@ -0,0 +1,58 @@
+#include "HashVerifier.hpp"
+#include "DeviceUtil.hpp"
+#include <QThread>
+#include <QUrl>
+
+HashVerifier::HashVerifier(QObject* parent) : QObject(parent), m_dat(std::make_shared<DatIndex>()) {
+    m_pool.setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));   // each file also keeps two digest helpers busy
+}
+
+HashVerifier::~HashVerifier() {
+    m_stop = true;
+    m_pool.waitForDone();
+    for (QThreadPool* p : std::as_const(m_diskPools)) { p->waitForDone(); delete p; }
+}
+
+bool HashVerifier::loadDat(QString path) {
+    if (path.startsWith("file:")) path = QUrl(path).toLocalFile();   // from a QML dialog
+    auto dat = std::make_shared<DatIndex>();
+    if (!dat->load(path, &m_error)) return false;
+    m_dat = std::move(dat);
+    m_error.clear();
+    emit datChanged();
+    return true;
+}
+
+void HashVerifier::clearDat() {
+    m_dat = std::make_shared<DatIndex>();
+    emit datChanged();
+}
+
+void HashVerifier::hashJob(const QString& id, const QStringList& files) {
+    if (files.isEmpty() || m_jobs.contains(id)) return;
+    auto batch = std::make_shared<Batch>();
+    batch->hashes.resize(files.size());
+    batch->left = int(files.size());
+    m_jobs.insert(id, batch);
+    emit pendingChanged();
+    for (int i=0; i<files.size(); ++i) {
+        const auto dev = DeviceUtil::deviceOf(files[i]);
+        QThreadPool* pool = &m_pool;
+        if (dev.kind==DeviceUtil::Kind::Rotational) {
+            QThreadPool*& disk = m_diskPools[dev.id];
+            if (!disk) { disk = new QThreadPool; disk->setMaxThreadCount(1); }
+            pool = disk;
+        }
+        pool->start([this, id, batch, i, file=files[i], dat=m_dat]{
+            Hasher::FileHash h = Hasher::hashFile(file, &m_stop);
+            dat->classify(h);
+            batch->hashes[i] = std::move(h);
+            if (--batch->left>0) return;
+            QMetaObject::invokeMethod(this, [this, id, batch]{
+                m_jobs.remove(id);
+                emit jobHashed(id, QList<Hasher::FileHash>(batch->hashes.begin(), batch->hashes.end()));
+                emit pendingChanged();
+            }, Qt::QueuedConnection);
+        });
+    }
+}
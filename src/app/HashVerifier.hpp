@@ -0,0 +1,50 @@
+#pragma once
+#include "DatIndex.hpp"
+#include "Hasher.hpp"
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Hashes the files of jobs in the background and checks them against a DAT.
+// Inputs are hashed while chdman converts them, so both read through the
+// same page cache; extracted outputs are hashed after the job. Files on
+// solid-state and network storage are hashed in parallel, files on each
+// rotational disk one at a time.
+class HashVerifier : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(QString datName READ datName NOTIFY datChanged)
+    Q_PROPERTY(int datEntries READ datEntries NOTIFY datChanged)
+    Q_PROPERTY(int pending READ pending NOTIFY pendingChanged)
+public:
+    explicit HashVerifier(QObject* parent=nullptr);
+    ~HashVerifier() override;
+
+    Q_INVOKABLE bool loadDat(QString path);
+    Q_INVOKABLE void clearDat();
+    QString datName() const { return m_dat->name(); }
+    int datEntries() const { return m_dat->size(); }
+    QString lastError() const { return m_error; }
+
+    void hashJob(const QString& id, const QStringList& files);
+    int pending() const { return int(m_jobs.size()); }
+
+signals:
+    void datChanged();
+    void pendingChanged();
+    void jobHashed(const QString& id, const QList<Hasher::FileHash>& hashes);
+
+private:
+    struct Batch {
+        std::vector<Hasher::FileHash> hashes;   // one slot per file, filled by workers
+        std::atomic<int> left{0};
+    };
+    std::shared_ptr<const DatIndex> m_dat;   // replaced, never modified, while tasks read it
+    QString m_error;
+    QThreadPool m_pool;
+    QHash<quint64, QThreadPool*> m_diskPools;   // one thread per rotational disk
+    QHash<QString, std::shared_ptr<Batch>> m_jobs;
+    std::atomic<bool> m_stop{false};
+};
@@ -0,0 +1,110 @@
+#include "Hasher.hpp"
+#include "SizeUtil.hpp"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <array>
+#include <cstring>
+#include <sys/mman.h>
+
+// Slicing-by-8 over the reflected IEEE polynomial (zlib's crc32). The x86
+// crc32 instruction computes CRC-32C, a different polynomial, so it can't be
+// used for DAT checksums; eight table lookups per 8 bytes run at several
+// GB/s, well ahead of MD5 and SHA1.
+using Tables = std::array<std::array<quint32, 256>, 8>;
+
+static constexpr Tables makeTables() {
+    Tables t{};
+    for (quint32 i=0; i<256; ++i) {
+        quint32 c = i;
+        for (int k=0; k<8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        t[0][i] = c;
+    }
+    for (quint32 i=0; i<256; ++i)
+        for (int s=1; s<8; ++s) t[s][i] = (t[s-1][i] >> 8) ^ t[0][t[s-1][i] & 0xff];
+    return t;
+}
+static constexpr Tables kCrc = makeTables();
+
+quint32 Hasher::crc32(const uchar* p, size_t n, quint32 crc) {
+    crc = ~crc;
+    while (n && (reinterpret_cast<quintptr>(p) & 7)) { crc = kCrc[0][(crc ^ *p++) & 0xff] ^ (crc >> 8); --n; }
+    while (n>=8) {
+        quint32 lo, hi;
+        memcpy(&lo, p, 4); memcpy(&hi, p + 4, 4);   // assumes a little-endian host
+        lo ^= crc;
+        crc = kCrc[7][lo & 0xff] ^ kCrc[6][(lo >> 8) & 0xff] ^ kCrc[5][(lo >> 16) & 0xff] ^ kCrc[4][lo >> 24]
+            ^ kCrc[3][hi & 0xff] ^ kCrc[2][(hi >> 8) & 0xff] ^ kCrc[1][(hi >> 16) & 0xff] ^ kCrc[0][hi >> 24];
+        p += 8; n -= 8;
+    }
+    while (n--) crc = kCrc[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Helpers only ever run digest work and never wait, so file tasks may block on them
+static QThreadPool& digestPool() {
+    static QThreadPool* pool = []{
+        auto p = new QThreadPool;
+        p->setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+        return p;
+    }();
+    return *pool;
+}
+
+Hasher::FileHash Hasher::hashFile(const QString& path, const std::atomic<bool>* cancelled) {
+    FileHash h;
+    h.file = path;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) { h.error = f.errorString(); return h; }
+    const qint64 size = f.size();
+    h.size = quint64(size);
+    QCryptographicHash md5(QCryptographicHash::Md5), sha1(QCryptographicHash::Sha1);
+    if (size>0) {
+        uchar* map = f.map(0, size);
+        if (!map) { h.error = f.errorString(); return h; }
+        madvise(map, size_t(size), MADV_SEQUENTIAL);
+        constexpr qint64 kChunk = 8 << 20;
+        QSemaphore done;
+        for (qint64 at = 0; at<size; at += kChunk) {
+            if (cancelled && *cancelled) { f.unmap(map); h.error = "cancelled"; return h; }
+            const QByteArrayView chunk(reinterpret_cast<const char*>(map + at), std::min(kChunk, size - at));
+            digestPool().start([&]{ md5.addData(chunk); done.release(); });
+            digestPool().start([&]{ sha1.addData(chunk); done.release(); });
+            h.crc32 = crc32(reinterpret_cast<const uchar*>(chunk.data()), size_t(chunk.size()), h.crc32);
+            done.acquire(2);
+            // Pages behind us won't be read again
+            madvise(map + at, size_t(chunk.size()) & ~size_t(4095), MADV_DONTNEED);
+        }
+        f.unmap(map);
+    }
+    h.md5 = md5.result();
+    h.sha1 = sha1.result();
+    h.ok = true;
+    return h;
+}
+
+QStringList Hasher::discFiles(const QString& input) {
+    QStringList files = SizeUtil::trackFiles(input);
+    if (!files.contains(input)) files.prepend(input);
+    return files;
+}
+
+QString Hasher::summary(const QList<FileHash>& hashes) {
+    int matched = 0, mismatched = 0, unreadable = 0;
+    QString game;
+    QStringList bad;
+    for (const auto& h : hashes) {
+        if (!h.ok) { ++unreadable; bad << QFileInfo(h.file).fileName(); continue; }
+        if (h.match==FileHash::Matched) { ++matched; if (game.isEmpty()) game = h.game; }
+        else if (h.match==FileHash::Mismatch) { ++mismatched; bad << QFileInfo(h.file).fileName(); }
+    }
+    if (unreadable) return QString("Hash: %1 unreadable (%2)").arg(unreadable).arg(bad.join(", "));
+    if (hashes.isEmpty() || hashes.first().match==FileHash::NotChecked)
+        return QString("Hashed %1 file(s)").arg(hashes.size());
+    if (mismatched) return QString("DAT: %1 mismatch (%2)").arg(mismatched).arg(bad.join(", "));
+    if (!matched) return "DAT: no match";
+    return QString("DAT: %1/%2 files match %3").arg(matched).arg(hashes.size()).arg(game);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+// CRC32, MD5 and SHA1 of disc files, as listed in Redump/No-Intro DATs.
+namespace Hasher {
+    struct FileHash {
+        QString file;
+        quint64 size = 0;
+        quint32 crc32 = 0;
+        QByteArray md5, sha1;    // raw digests
+        bool ok = false;         // false: unreadable (see error)
+        QString error;
+        enum Match { NotChecked, Matched, Unknown, Mismatch };
+        Match match = NotChecked;   // against the loaded DAT
+        QString game;               // DAT game of a match, or of the rom a mismatch was named after
+
+        QString crcHex() const { return QString::number(crc32, 16).rightJustified(8, '0'); }
+    };
+
+    quint32 crc32(const uchar* data, size_t len, quint32 crc = 0);
+
+    // One pass over a read-only mapping of the file: each chunk goes to the
+    // three digests at once, MD5 and SHA1 on helper threads.
+    FileHash hashFile(const QString& path, const std::atomic<bool>* cancelled = nullptr);
+
+    // Files a disc consists of: the descriptor (if any) and its tracks
+    QStringList discFiles(const QString& input);
+
+    // e.g. "DAT: 3/3 files match Game (USA)" or "DAT: 1 mismatch (track 2)"
+    QString summary(const QList<FileHash>& hashes);
+}
+Q_DECLARE_METATYPE(QList<Hasher::FileHash>)
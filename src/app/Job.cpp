@@ -1 +1,76 @@
-// Intentionally empty (placeholder for future helpers)
+#include "Job.hpp"
+#include <QJsonArray>
+#include <algorithm>
+
+QList<Job> buildPipeline(const Job& base, bool verify) {
+    const bool create = base.type==JobType::Create;
+    const bool del = base.deleteSourceAfter && (create || base.type==JobType::Extract);
+    verify = create && (verify || del) && !base.outputPath.isEmpty();
+    if (!verify && !del) return { base };
+
+    QList<Job> steps{ base };
+    steps[0].pipeline = base.id;
+    auto step = [&](const QString& suffix, JobType type, const QString& input){
+        Job j;
+        j.id = base.id + suffix;
+        j.type = type; j.media = base.media;
+        j.inputPath = input;
+        j.preserveStructure = base.preserveStructure;
+        j.priority = base.priority;
+        j.pipeline = base.id;
+        j.dependsOn = { steps.last().id };
+        steps << j;
+    };
+    if (verify) step("-verify", JobType::Verify, base.outputPath);
+    if (del) step("-delete", JobType::DeleteSource, base.inputPath);
+    return steps;
+}
+
+QJsonObject jobToJson(const Job& j) {
+    return {{"id", j.id}, {"type", int(j.type)}, {"media", int(j.media)},
+            {"input", j.inputPath}, {"output", j.outputPath},
+            {"extraArgs", QJsonArray::fromStringList(j.extraArgs)},
+            {"deleteSource", j.deleteSourceAfter}, {"preserve", j.preserveStructure},
+            {"priority", j.priority}, {"linkOutputs", QJsonArray::fromStringList(j.linkOutputs)},
+            {"dependsOn", QJsonArray::fromStringList(j.dependsOn)}, {"pipeline", j.pipeline}};
+}
+
+static QStringList stringList(const QJsonValue& v) {
+    QStringList out;
+    for (const auto& e : v.toArray()) out << e.toString();
+    return out;
+}
+
+Job jobFromJson(const QJsonObject& o) {
+    Job j;
+    j.id = o.value("id").toString();
+    j.type = static_cast<JobType>(std::clamp(o.value("type").toInt(), 0, int(JobType::DeleteSource)));
+    j.media = o.value("media").toInt()==1 ? MediaType::DVD : MediaType::CD;
+    j.inputPath = o.value("input").toString();
+    j.outputPath = o.value("output").toString();
+    j.extraArgs = stringList(o.value("extraArgs"));
+    j.deleteSourceAfter = o.value("deleteSource").toBool();
+    j.preserveStructure = o.value("preserve").toBool(true);
+    j.priority = o.value("priority").toInt();
+    j.linkOutputs = stringList(o.value("linkOutputs"));
+    j.dependsOn = stringList(o.value("dependsOn"));
+    j.pipeline = o.value("pipeline").toString();
+    return j;
+}
+
+QJsonObject statsToJson(const JobStats& s) {
+    return {{"userSec", s.userSec}, {"sysSec", s.sysSec}, {"maxRssKb", qint64(s.maxRssKb)},
+            {"readBytes", qint64(s.readBytes)}, {"writeBytes", qint64(s.writeBytes)},
+            {"mbps", s.mbps}, {"etaSec", s.etaSec}};
+}
+
+JobStats statsFromJson(const QJsonObject& o) {
+    JobStats s;
+    s.userSec = o.value("userSec").toDouble(); s.sysSec = o.value("sysSec").toDouble();
+    s.maxRssKb = quint64(o.value("maxRssKb").toInteger());
+    s.readBytes = quint64(o.value("readBytes").toInteger());
+    s.writeBytes = quint64(o.value("writeBytes").toInteger());
+    s.mbps = o.value("mbps").toDouble();
+    s.etaSec = o.value("etaSec").toInt(-1);
+    return s;
+}
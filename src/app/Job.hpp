@@ -2,10 +2,24 @@
 #include <QString>
 #include <QStringList>
 #include <QDateTime>
+#include <QJsonObject>
+#include <QVariantMap>
+#include <QMetaType>
 
-enum class JobType { Create, Verify, Info, Extract };
+enum class JobType { Create, Verify, Info, Extract, DeleteSource };
 enum class MediaType { CD, DVD };
 
+// Telemetry of a job's chdman process: resource usage sampled from /proc
+// while it runs, plus live throughput against the estimated input size.
+struct JobStats {
+    double userSec = 0, sysSec = 0;
+    quint64 maxRssKb = 0;
+    quint64 readBytes = 0, writeBytes = 0;
+    double mbps = 0;     // input MiB/s so far
+    int etaSec = -1;
+};
+Q_DECLARE_METATYPE(JobStats)
+
 struct Job {
     QString id;
     JobType type{};
@@ -14,9 +28,27 @@ struct Job {
     QString outputPath;
     QStringList extraArgs;
     int progress = 0;                // 0..100
+    double ratio = -1;               // chdman's compression ratio in %, once reported
     QString status = "Queued";       // Queued/Running/Done/Failed
-    QString log;
     QDateTime started, ended;
     bool deleteSourceAfter = false;
     bool preserveStructure = true;
+    int priority = 0;                // higher runs first, regardless of queue policy
+    QStringList linkOutputs;         // outputs of identical inputs, linked to ours on success
+    QStringList dependsOn;           // jobs that must succeed before this one is queued
+    QString pipeline;                // id shared by the steps of one input's pipeline
+    QVariantMap info;                // structured result of native Info jobs
+    JobStats stats;
 };
+
+// Expands a job into its pipeline: create → verify (if asked for, or when the
+// source is to be deleted) → delete source; extract → delete source. Step ids
+// derive from base.id. Jobs without follow-up steps come back unchanged.
+QList<Job> buildPipeline(const Job& base, bool verify);
+
+// JSON form of a job's definition (not its progress), and of its stats; used
+// by remote workers and the job journal.
+QJsonObject jobToJson(const Job& j);
+Job jobFromJson(const QJsonObject& o);
+QJsonObject statsToJson(const JobStats& s);
+JobStats statsFromJson(const QJsonObject& o);
@@ -0,0 +1,68 @@
+#include "JobFilterModel.hpp"
+#include "JobModel.hpp"
+
+JobFilterModel::JobFilterModel(JobModel* jobs, QObject* parent)
+    : QSortFilterProxyModel(parent), m_jobs(jobs) {
+    setSourceModel(jobs);
+    // Only these roles can move a row in or out (status) or around (folder)
+    setFilterRole(JobModel::StatusRole);
+    setSortRole(JobModel::SourceDirRole);
+    setDynamicSortFilter(true);
+    connect(this, &QAbstractItemModel::rowsInserted, this, &JobFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &JobFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &JobFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::layoutChanged, this, &JobFilterModel::countChanged);
+}
+
+void JobFilterModel::refilter() {
+    invalidateFilter();
+    emit filterChanged();
+    emit countChanged();
+}
+
+void JobFilterModel::setStatus(const QString& status) {
+    if (m_status==status) return;
+    m_status = status;
+    refilter();
+}
+
+void JobFilterModel::setType(int type) {
+    if (m_type==type) return;
+    m_type = type;
+    refilter();
+}
+
+void JobFilterModel::setMedia(int media) {
+    if (m_media==media) return;
+    m_media = media;
+    refilter();
+}
+
+void JobFilterModel::setSearch(const QString& text) {
+    const QString t = text.trimmed();
+    if (m_search==t) return;
+    m_search = t;
+    refilter();
+}
+
+void JobFilterModel::setGrouped(bool on) {
+    if (m_grouped==on) return;
+    m_grouped = on;
+    sort(on ? 0 : -1);   // -1 restores the queue order
+    emit filterChanged();
+}
+
+bool JobFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex&) const {
+    const Job& j = m_jobs->jobAt(sourceRow);
+    if (!m_status.isEmpty() && j.status!=m_status) return false;
+    if (m_type>=0 && int(j.type)!=m_type) return false;
+    if (m_media>=0 && int(j.media)!=m_media) return false;
+    return m_search.isEmpty() || j.inputPath.contains(m_search, Qt::CaseInsensitive)
+                              || j.outputPath.contains(m_search, Qt::CaseInsensitive);
+}
+
+// Folder, then queue order within it
+bool JobFilterModel::lessThan(const QModelIndex& left, const QModelIndex& right) const {
+    const int c = QString::compare(m_jobs->sourceDirAt(left.row()), m_jobs->sourceDirAt(right.row()));
+    return c!=0 ? c<0 : left.row()<right.row();
+}
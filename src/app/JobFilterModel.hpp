@@ -0,0 +1,48 @@
+#pragma once
+#include <QSortFilterProxyModel>
+
+class JobModel;
+
+// Filtered view of a JobModel for the queue list, optionally grouped by
+// source folder. Rows are matched on the jobs themselves rather than through
+// data(), and as jobs run only a status change re-filters a row.
+class JobFilterModel : public QSortFilterProxyModel {
+    Q_OBJECT
+    Q_PROPERTY(QString status READ status WRITE setStatus NOTIFY filterChanged)   // empty = any
+    Q_PROPERTY(int type READ type WRITE setType NOTIFY filterChanged)             // JobType, -1 = any
+    Q_PROPERTY(int media READ media WRITE setMedia NOTIFY filterChanged)          // MediaType, -1 = any
+    Q_PROPERTY(QString search READ search WRITE setSearch NOTIFY filterChanged)   // in input or output path
+    Q_PROPERTY(bool grouped READ grouped WRITE setGrouped NOTIFY filterChanged)   // sorted by source folder
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+    explicit JobFilterModel(JobModel* jobs, QObject* parent=nullptr);
+
+    QString status() const { return m_status; }
+    void setStatus(const QString& status);
+    int type() const { return m_type; }
+    void setType(int type);
+    int media() const { return m_media; }
+    void setMedia(int media);
+    QString search() const { return m_search; }
+    void setSearch(const QString& text);
+    bool grouped() const { return m_grouped; }
+    void setGrouped(bool on);
+    int count() const { return rowCount(); }
+
+signals:
+    void filterChanged();
+    void countChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
+    bool lessThan(const QModelIndex& left, const QModelIndex& right) const override;
+
+private:
+    JobModel* m_jobs;
+    QString m_status;
+    int m_type = -1, m_media = -1;
+    QString m_search;
+    bool m_grouped = false;
+
+    void refilter();
+};
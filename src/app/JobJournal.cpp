@@ -0,0 +1,224 @@
+#include "JobJournal.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utility>
+
+// One record per line:
+//   + <job as JSON>   added (again: back to queued)
+//   R <id>            started
+//   D <id> / F <id>   succeeded / failed
+//   Q <id>            queued again
+//   U <id> <dir>      unpacking into dir
+//   X <id>            removed from the queue
+static const QByteArray kHeader = "opendhc-journal 1\n";
+static constexpr int kWriteThreshold = 1 << 20;   // write out early past this, sync on the timer
+
+JobJournal::JobJournal(QObject* parent) : QObject(parent) {
+    m_syncTimer.setSingleShot(true);
+    m_syncTimer.setInterval(kSyncIntervalMs);
+    connect(&m_syncTimer, &QTimer::timeout, this, &JobJournal::sync);
+}
+
+JobJournal::~JobJournal() { close(); }
+
+void JobJournal::close() {
+    if (m_fd<0) return;
+    sync();
+    ::close(m_fd);
+    m_fd = -1;
+    m_deleteSteps.clear();
+}
+
+// What a running create/extract job leaves behind: its output, the ".part" of
+// a staged move, and the .bin of an extracted .cue
+static void removePartialOutput(const Job& j) {
+    if ((j.type!=JobType::Create && j.type!=JobType::Extract) || j.outputPath.isEmpty()) return;
+    QFile::remove(j.outputPath);
+    QFile::remove(j.outputPath + ".part");
+    if (j.type==JobType::Extract && j.outputPath.endsWith(".cue", Qt::CaseInsensitive))
+        QFile::remove(j.outputPath.chopped(4) + ".bin");
+}
+
+JobJournal::Recovery JobJournal::open(const QString& file, const QString& stagingDir) {
+    close();
+    Recovery rec;
+    QByteArray data;
+    {
+        QFile f(file);
+        if (f.open(QIODevice::ReadOnly)) data = f.readAll();
+    }
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    m_fd = ::open(QFile::encodeName(file).constData(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd<0) return rec;
+
+    struct Entry { Job j; char state = 'Q'; QString unpackDir; };
+    QHash<QString, Entry> entries;
+    QStringList order;
+    qsizetype pos = data.startsWith(kHeader) ? kHeader.size() : 0;
+    const bool valid = pos>0;
+    while (valid && pos<data.size()) {
+        const qsizetype nl = data.indexOf('\n', pos);
+        if (nl<0) break;   // torn by the crash; cut off below
+        const qsizetype start = pos;
+        pos = nl + 1;
+        if (nl - start < 3 || data[start+1]!=' ') continue;
+        const char op = data[start];
+        if (op=='+') {
+            const auto doc = QJsonDocument::fromJson(data.mid(start + 2, nl - start - 2));
+            if (!doc.isObject()) continue;
+            Job j = jobFromJson(doc.object());
+            const QString id = j.id;
+            auto it = entries.find(id);
+            if (it==entries.end()) { order << id; entries.insert(id, { std::move(j) }); }
+            else { it->j = std::move(j); it->state = 'Q'; }
+        } else if (op=='U') {
+            const QString rec = QString::fromUtf8(data.constData() + start + 2, nl - start - 2);
+            const qsizetype sp = rec.indexOf(' ');
+            auto it = sp>0 ? entries.find(rec.left(sp)) : entries.end();
+            if (it!=entries.end()) it->unpackDir = rec.mid(sp + 1);
+        } else if (op=='R' || op=='D' || op=='F' || op=='Q' || op=='X') {
+            auto it = entries.find(QString::fromUtf8(data.constData() + start + 2, nl - start - 2));
+            if (it!=entries.end()) it->state = op;
+        }
+    }
+
+    for (const auto& id : order) {
+        Entry& e = entries[id];
+        if (!e.unpackDir.isEmpty()) QDir(e.unpackDir).removeRecursively();   // gone already unless cut short
+        if (e.state=='D' || e.state=='F' || e.state=='X') {
+            rec.finished << id;
+            if (e.state=='D' && (e.j.pipeline.isEmpty() || e.j.pipeline==id)) rec.doneInputs << e.j.inputPath;
+            continue;
+        }
+        if (e.state=='R') {
+            removePartialOutput(e.j);
+            if (!stagingDir.isEmpty()) QDir(QDir(stagingDir).filePath("opendhc-" + id)).removeRecursively();
+            rec.interrupted << id;
+        }
+        // Steps ahead of this one that settled won't settle again in the runner
+        QStringList deps;
+        bool skipped = false;
+        for (const auto& dep : e.j.dependsOn) {
+            const auto d = entries.constFind(dep);
+            if (d==entries.constEnd() || d->state=='D') continue;
+            if (d->state=='F' || d->state=='X') { skipped = true; break; }
+            deps << dep;
+        }
+        if (skipped) {
+            e.state = 'F';
+            append('F', id);
+            rec.finished << id;
+            continue;
+        }
+        e.j.dependsOn = deps;
+        rec.jobs << e.j;
+    }
+
+    // Cut a torn record so the next one starts on a line of its own; a file
+    // that isn't a journal starts over
+    const qsizetype keep = valid ? pos : 0;
+    if (keep<data.size()) ::ftruncate(m_fd, keep);
+    if (keep==0) m_buf.prepend(kHeader);
+    sync();
+    return rec;
+}
+
+void JobJournal::reset() {
+    if (m_fd<0) return;
+    m_buf = kHeader;
+    ::ftruncate(m_fd, 0);
+    sync();
+}
+
+void JobJournal::added(const QList<Job>& jobs) {
+    if (m_fd<0) return;
+    for (const auto& j : jobs) {
+        m_buf += "+ ";
+        m_buf += QJsonDocument(jobToJson(j)).toJson(QJsonDocument::Compact);
+        m_buf += '\n';
+        if (j.type==JobType::DeleteSource) m_deleteSteps.insert(j.id);
+    }
+    schedule();
+}
+
+void JobJournal::started(const QString& id) {
+    append('R', id);
+    if (m_deleteSteps.contains(id)) sync();   // the steps that made the deletion safe must not be lost
+}
+
+void JobJournal::finished(const QString& id, bool ok) {
+    append(ok ? 'D' : 'F', id);
+    m_deleteSteps.remove(id);
+}
+
+void JobJournal::requeued(const QString& id) {
+    append('Q', id);
+}
+
+void JobJournal::unpacking(const QString& id, const QString& dir) {
+    append('U', id, dir);
+}
+
+void JobJournal::removed(const QString& id) {
+    append('X', id);
+    m_deleteSteps.remove(id);
+}
+
+void JobJournal::offer(const Recovery& rec) {
+    m_offered = rec;
+    emit resumableChanged();
+}
+
+void JobJournal::resume() {
+    const Recovery rec = std::exchange(m_offered, Recovery{});
+    emit resumableChanged();
+    emit resumed(rec);
+}
+
+void JobJournal::discard() {
+    for (const auto& j : std::as_const(m_offered.jobs)) removed(j.id);
+    m_offered = Recovery{};
+    emit resumableChanged();
+}
+
+void JobJournal::append(char op, const QString& id, const QString& arg) {
+    if (m_fd<0) return;
+    m_buf += op;
+    m_buf += ' ';
+    m_buf += id.toUtf8();
+    if (!arg.isEmpty()) { m_buf += ' '; m_buf += arg.toUtf8(); }
+    m_buf += '\n';
+    schedule();
+}
+
+void JobJournal::schedule() {
+    if (m_buf.size() >= kWriteThreshold) writeOut();
+    if (!m_syncTimer.isActive()) m_syncTimer.start();
+}
+
+bool JobJournal::writeOut() {
+    qsizetype done = 0;
+    while (done<m_buf.size()) {
+        const ssize_t n = ::write(m_fd, m_buf.constData() + done, size_t(m_buf.size() - done));
+        if (n<0 && errno==EINTR) continue;
+        if (n<=0) break;
+        done += n;
+    }
+    const bool ok = done==m_buf.size();
+    m_buf.clear();   // on failure too: a journal that can't be written mustn't grow in memory
+    return ok;
+}
+
+void JobJournal::sync() {
+    m_syncTimer.stop();
+    if (m_fd<0) return;
+    if (!m_buf.isEmpty()) writeOut();
+    ::fdatasync(m_fd);
+}
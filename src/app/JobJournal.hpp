@@ -0,0 +1,73 @@
+#pragma once
+#include "Job.hpp"
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+// Append-only record of a batch's jobs and their state changes, so a batch
+// cut short by a crash, reboot or logout resumes where it stopped. Records are
+// buffered and made durable with one fdatasync per interval; a lost tail only
+// means re-running the jobs that had just finished. The journal is always
+// synced before a source is deleted.
+class JobJournal : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(int resumableJobs READ resumableJobs NOTIFY resumableChanged)
+public:
+    static constexpr int kSyncIntervalMs = 1000;
+
+    struct Recovery {
+        QList<Job> jobs;             // to queue again, in their original order
+        QSet<QString> interrupted;   // were running; partial outputs removed
+        QSet<QString> doneInputs;    // inputs of first steps that succeeded
+        QStringList finished;        // settled or removed jobs, not queued again
+    };
+
+    explicit JobJournal(QObject* parent=nullptr);
+    ~JobJournal() override;
+
+    // Reads the journal and reopens it for appending. Jobs that were running
+    // lose their partial outputs and staging directories, and every job its
+    // unpack directory; dependencies on steps that succeeded are dropped and
+    // steps behind a failed one are settled as failed.
+    Recovery open(const QString& file, const QString& stagingDir);
+    bool isOpen() const { return m_fd>=0; }
+    void close();
+    // Empties the journal once its batch is over
+    void reset();
+
+    // Adding a job again (as when resuming) resets it to queued
+    void added(const QList<Job>& jobs);
+    void started(const QString& id);
+    void finished(const QString& id, bool ok);
+    void requeued(const QString& id);
+    void unpacking(const QString& id, const QString& dir);
+    // Taken off the queue without running; not resumed
+    void removed(const QString& id);
+
+    // Holds a recovered batch until the user decides: resume() hands it over
+    // through resumed(), discard() records its jobs as removed
+    void offer(const Recovery& rec);
+    int resumableJobs() const { return int(m_offered.jobs.size()); }
+    Q_INVOKABLE void resume();
+    Q_INVOKABLE void discard();
+    // Writes what's buffered and waits for it to reach the disk
+    void sync();
+
+signals:
+    void resumableChanged();
+    void resumed(const JobJournal::Recovery& rec);
+
+private:
+    int m_fd = -1;
+    Recovery m_offered;
+    QByteArray m_buf;
+    QTimer m_syncTimer;
+    QSet<QString> m_deleteSteps;   // DeleteSource jobs: sync before they start
+
+    void append(char op, const QString& id, const QString& arg = QString());
+    void schedule();
+    bool writeOut();
+};
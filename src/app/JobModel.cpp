@@ -1,2 +1,109 @@
 #include "JobModel.hpp"
-// implementation in header (inline-sized)
+#include "Archive.hpp"
+#include <algorithm>
+
+JobModel::JobModel(QObject* parent) : QAbstractListModel(parent) {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(16);   // one frame at 60 Hz
+    connect(&m_flushTimer, &QTimer::timeout, this, &JobModel::flushUpdates);
+}
+
+int JobModel::statusSlot(const QString& status) {
+    static const QString kStatuses[] = { "Queued", "Running", "Done", "Failed" };
+    for (int s=0; s<4; ++s) if (status==kStatuses[s]) return s;
+    return -1;
+}
+
+QString JobModel::dirOf(const Job& j) const {
+    if (!j.pipeline.isEmpty() && j.pipeline!=j.id) {
+        const int first = indexById(j.pipeline);
+        if (first>=0) return m_dirs[first];
+    }
+    QString path = j.inputPath, archive;
+    if (path.contains('#') && Archive::split(path, &archive, nullptr)) path = archive;
+    return path.left(std::max(0, int(path.lastIndexOf('/'))));
+}
+
+void JobModel::updateJob(const QString& id, std::function<void(Job&)> fn, const QList<int>& roles) {
+    const int i = indexById(id); if (i<0) return;
+    if (fn) {
+        Job& j = m_jobs[i];
+        const int before = statusSlot(j.status);
+        fn(j);
+        if (const int after = statusSlot(j.status); after!=before) {
+            if (before>=0) --m_counts[before];
+            if (after>=0) ++m_counts[after];
+            m_countsDirty = true;
+        }
+    }
+    auto it = m_dirty.find(i);
+    if (it==m_dirty.end()) {
+        m_dirty.insert(i, roles);
+    } else if (!it->isEmpty()) {
+        if (roles.isEmpty()) it->clear();
+        else for (int r : roles) if (!it->contains(r)) it->append(r);
+    }
+    if (!m_flushTimer.isActive()) m_flushTimer.start();
+}
+
+void JobModel::flushUpdates() {
+    m_flushTimer.stop();
+    if (m_countsDirty) { m_countsDirty = false; emit countsChanged(); }
+    if (m_dirty.isEmpty()) return;
+    QList<int> rows = m_dirty.keys();
+    std::sort(rows.begin(), rows.end());
+    // Merge runs of adjacent rows that changed the same roles
+    int first = rows.first(), last = first;
+    QList<int> roles = m_dirty.value(first);
+    for (int k=1; k<=rows.size(); ++k) {
+        if (k<rows.size() && rows[k]==last+1 && m_dirty.value(rows[k])==roles) { last = rows[k]; continue; }
+        emit dataChanged(index(first), index(last), roles);
+        if (k==rows.size()) break;
+        first = last = rows[k];
+        roles = m_dirty.value(first);
+    }
+    m_dirty.clear();
+}
+
+void JobModel::removeJob(const QString& id) {
+    const int i = indexById(id); if (i<0) return;
+    flushUpdates();   // pending rows would shift
+    beginRemoveRows({}, i, i);
+    if (m_logs) m_logs->release(id);
+    m_rowById.remove(id);
+    count(m_jobs[i], -1);
+    m_jobs.removeAt(i);
+    m_dirs.removeAt(i);
+    for (int r=i; r<m_jobs.size(); ++r) m_rowById[m_jobs[r].id] = r;
+    endRemoveRows();
+    emit countsChanged();
+    emit jobRemoved(id);
+}
+
+QString JobModel::addPipeline(int type, int media, const QString& input, const QString& output,
+                              const QStringList& extraArgs, bool delSrc, bool preserve, bool verify,
+                              const QStringList& linkOutputs) {
+    Job j;
+    j.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    j.type = static_cast<JobType>(type);
+    j.media = static_cast<MediaType>(media);
+    j.inputPath = input; j.outputPath = output;
+    j.extraArgs = extraArgs; j.deleteSourceAfter = delSrc; j.preserveStructure = preserve;
+    j.linkOutputs = linkOutputs;
+    addJobs(buildPipeline(j, verify));
+    return j.id;
+}
+
+void JobModel::addJobs(const QList<Job>& jobs) {
+    if (jobs.isEmpty()) return;
+    beginInsertRows({}, m_jobs.size(), m_jobs.size() + jobs.size() - 1);
+    for (const auto& j : jobs) {
+        m_rowById.insert(j.id, m_jobs.size());
+        m_dirs.push_back(dirOf(j));
+        count(j, 1);
+        m_jobs.push_back(j);
+    }
+    endInsertRows();
+    emit countsChanged();
+    emit jobsAdded(jobs);
+}
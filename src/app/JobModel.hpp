@@ -1,17 +1,30 @@
 #pragma once
 #include "Job.hpp"
+#include "LogStore.hpp"
 #include <QAbstractListModel>
+#include <QHash>
+#include <QTimer>
 #include <QUuid>
 #include <functional>
+#include <stdexcept>
 
 class JobModel : public QAbstractListModel {
     Q_OBJECT
+    // Jobs per status, kept up to date as jobs change
+    Q_PROPERTY(int queuedCount READ queuedCount NOTIFY countsChanged)
+    Q_PROPERTY(int runningCount READ runningCount NOTIFY countsChanged)
+    Q_PROPERTY(int doneCount READ doneCount NOTIFY countsChanged)
+    Q_PROPERTY(int failedCount READ failedCount NOTIFY countsChanged)
 public:
     enum Roles {
         IdRole = Qt::UserRole+1, TypeRole, MediaRole, InputRole, OutputRole,
-        ProgressRole, StatusRole, LogRole, DeleteSourceRole, PreserveRole
+        ProgressRole, StatusRole, LogRole, DeleteSourceRole, PreserveRole, InfoRole, RatioRole,
+        MbpsRole, EtaRole, PipelineRole, SourceDirRole
     };
-    explicit JobModel(QObject* parent=nullptr) : QAbstractListModel(parent) {}
+    explicit JobModel(QObject* parent=nullptr);
+
+    // LogRole exposes only the tail kept by the store
+    void setLogStore(LogStore* logs) { m_logs = logs; }
 
     int rowCount(const QModelIndex& parent = QModelIndex()) const override {
         return parent.isValid() ? 0 : m_jobs.size();
@@ -27,9 +40,15 @@ public:
             case OutputRole: return j.outputPath;
             case ProgressRole: return j.progress;
             case StatusRole: return j.status;
-            case LogRole: return j.log;
+            case LogRole: return m_logs ? m_logs->tail(j.id) : QString();
             case DeleteSourceRole: return j.deleteSourceAfter;
             case PreserveRole: return j.preserveStructure;
+            case InfoRole: return j.info;
+            case RatioRole: return j.ratio;
+            case MbpsRole: return j.stats.mbps;
+            case EtaRole: return j.stats.etaSec;
+            case PipelineRole: return j.pipeline;
+            case SourceDirRole: return m_dirs[idx.row()];
         }
         return {};
     }
@@ -38,10 +57,12 @@ public:
             {IdRole,"id"}, {TypeRole,"type"}, {MediaRole,"media"},
             {InputRole,"input"}, {OutputRole,"output"}, {ProgressRole,"progress"},
             {StatusRole,"status"}, {LogRole,"log"}, {DeleteSourceRole,"deleteSource"},
-            {PreserveRole,"preserveStructure"}
+            {PreserveRole,"preserveStructure"}, {InfoRole,"info"}, {RatioRole,"ratio"},
+            {MbpsRole,"mbps"}, {EtaRole,"eta"}, {PipelineRole,"pipeline"}, {SourceDirRole,"sourceDir"}
         };
     }
 
+    // Adds a single job, without follow-up steps, through addJobs()
     Q_INVOKABLE QString addJob(int type, int media, const QString& input, const QString& output,
                                const QStringList& extraArgs, bool delSrc, bool preserve) {
         Job j;
@@ -50,32 +71,56 @@ public:
         j.media = static_cast<MediaType>(media);
         j.inputPath = input; j.outputPath = output;
         j.extraArgs = extraArgs; j.deleteSourceAfter = delSrc; j.preserveStructure = preserve;
-        beginInsertRows({}, m_jobs.size(), m_jobs.size());
-        m_jobs.push_back(std::move(j));
-        endInsertRows();
-        return m_jobs.back().id;
+        addJobs({ j });
+        return j.id;
     }
 
+    // Adds the job and its follow-up steps (see buildPipeline) and announces
+    // them through jobsAdded(), which hands them to the runner. Returns the
+    // id of the first step.
+    Q_INVOKABLE QString addPipeline(int type, int media, const QString& input, const QString& output,
+                                    const QStringList& extraArgs, bool delSrc, bool preserve, bool verify,
+                                    const QStringList& linkOutputs = {});
+    void addJobs(const QList<Job>& jobs);
+
     Job& jobRefById(const QString& id) {
-        for (auto& j : m_jobs) if (j.id==id) return j;
-        throw std::runtime_error("job not found");
-    }
-    int indexById(const QString& id) const {
-        for (int i=0;i<m_jobs.size();++i) if (m_jobs[i].id==id) return i;
-        return -1;
-    }
-    void updateJob(const QString& id, std::function<void(Job&)> fn) {
-        int i = indexById(id); if (i<0) return;
-        fn(m_jobs[i]);
-        emit dataChanged(index(i), index(i));
-    }
-    Q_INVOKABLE void removeJob(const QString& id) {
-        int i = indexById(id); if (i<0) return;
-        beginRemoveRows({}, i, i);
-        m_jobs.removeAt(i);
-        endRemoveRows();
+        auto it = m_rowById.constFind(id);
+        if (it==m_rowById.constEnd()) throw std::runtime_error("job not found");
+        return m_jobs[*it];
     }
+    int indexById(const QString& id) const { return m_rowById.value(id, -1); }
+    const Job& jobAt(int row) const { return m_jobs[row]; }
+    // Folder a job's disc came from; follow-up steps take their pipeline's
+    const QString& sourceDirAt(int row) const { return m_dirs[row]; }
+
+    int queuedCount() const { return m_counts[0]; }
+    int runningCount() const { return m_counts[1]; }
+    int doneCount() const { return m_counts[2]; }
+    int failedCount() const { return m_counts[3]; }
+
+    // Applies fn (if any) immediately; views are notified on the next flush (at
+    // most once per frame) and only for the given roles. No roles means the whole row.
+    void updateJob(const QString& id, std::function<void(Job&)> fn, const QList<int>& roles = {});
+    void flushUpdates();
+
+    Q_INVOKABLE void removeJob(const QString& id);
+
+signals:
+    void jobsAdded(const QList<Job>& jobs);
+    void jobRemoved(const QString& id);
+    void countsChanged();   // with the next view update, not on every change
 
 private:
     QVector<Job> m_jobs;
+    QVector<QString> m_dirs;   // by row, see sourceDirAt()
+    int m_counts[4] = {};      // Queued, Running, Done, Failed
+    bool m_countsDirty = false;
+    LogStore* m_logs = nullptr;
+    QHash<QString,int> m_rowById;
+    QHash<int,QList<int>> m_dirty;   // row -> changed roles (empty = all)
+    QTimer m_flushTimer;
+
+    static int statusSlot(const QString& status);
+    void count(const Job& j, int delta) { if (int s = statusSlot(j.status); s>=0) m_counts[s] += delta; }
+    QString dirOf(const Job& j) const;
 };
@@ -0,0 +1,109 @@
+#include "LogStore.hpp"
+#include <QDir>
+
+void LogStore::setSpillDir(const QString& dir) {
+    m_spillDir = dir;
+    if (dir.isEmpty()) return;
+    QDir().mkpath(dir);
+    QDir d(dir);
+    for (const auto& name : d.entryList({ "*.log" }, QDir::Files))
+        if (!m_entries.contains(name.chopped(4))) d.remove(name);
+}
+
+QString LogStore::spillPath(const QString& id) const {
+    return m_spillDir.isEmpty() ? QString() : QDir(m_spillDir).filePath(id + ".log");
+}
+
+void LogStore::append(const QString& id, const QString& line) {
+    auto& ep = m_entries[id];
+    if (!ep) {
+        ep = std::make_shared<Entry>();
+        if (!m_spillDir.isEmpty()) {
+            ep->spill = std::make_unique<QFile>(spillPath(id));
+            if (!ep->spill->open(QIODevice::WriteOnly | QIODevice::Truncate)) ep->spill.reset();
+        }
+    }
+    Entry& e = *ep;
+    if (e.finished) {
+        // Job re-run (pipeline retry): keep appending to the same file
+        e.finished = false;
+        if (!m_spillDir.isEmpty()) {
+            e.spill = std::make_unique<QFile>(spillPath(id));
+            if (!e.spill->open(QIODevice::WriteOnly | QIODevice::Append)) e.spill.reset();
+        }
+    }
+    if (e.spill) { e.spill->write(line.toUtf8()); e.spill->write("\n", 1); }
+    const QString kept = line.size()>kMaxLineChars ? line.left(kMaxLineChars) + QStringLiteral("…") : line;
+    if (e.ring.size() < m_capacity) {
+        e.ring.push_back(kept);
+    } else {
+        e.ring[e.head] = kept;
+        e.head = (e.head+1) % e.ring.size();
+    }
+    ++e.total;
+}
+
+QStringList LogStore::lastLines(const Entry& e, int lines) {
+    const int n = e.ring.size();
+    const int take = std::min(lines, n);
+    QStringList out;
+    out.reserve(take);
+    for (int k=n-take; k<n; ++k) out << e.ring[(e.head+k) % n];
+    return out;
+}
+
+void LogStore::shrink(Entry& e, int lines) {
+    if (e.ring.size()<=lines) return;
+    const QStringList keep = lastLines(e, lines);
+    e.ring = QVector<QString>(keep.begin(), keep.end());
+    e.ring.squeeze();
+    e.head = 0;
+}
+
+void LogStore::finish(const QString& id) {
+    auto it = m_entries.find(id);
+    if (it==m_entries.end()) return;
+    Entry& e = **it;
+    e.finished = true;
+    if (e.spill) {
+        e.spill->close();
+        e.spill.reset();
+        shrink(e, kTailLines);
+    } else {
+        shrink(e, kFinishedLines);
+    }
+}
+
+void LogStore::release(const QString& id) {
+    m_entries.remove(id);
+    removeSpill(id);
+}
+
+void LogStore::removeSpill(const QString& id) {
+    if (m_entries.contains(id)) return;   // still shown; its file goes with release()
+    const QString path = spillPath(id);
+    if (!path.isEmpty()) QFile::remove(path);
+}
+
+QString LogStore::tail(const QString& id, int lines) const {
+    auto it = m_entries.constFind(id);
+    if (it==m_entries.constEnd()) return QString();
+    return lastLines(**it, lines).join('\n');
+}
+
+QString LogStore::fullLog(const QString& id) const {
+    auto it = m_entries.constFind(id);
+    if (it!=m_entries.constEnd() && (*it)->spill) (*it)->spill->flush();
+    const QString path = spillPath(id);
+    if (!path.isEmpty()) {
+        QFile f(path);
+        if (f.open(QIODevice::ReadOnly)) return QString::fromUtf8(f.readAll());
+    }
+    if (it==m_entries.constEnd()) return QString();
+    // Not spilled: the ring is all we have
+    const Entry& e = **it;
+    QString out = lastLines(e, e.ring.size()).join('\n');
+    if (e.total > quint64(e.ring.size()))
+        out.prepend(QString("[… %1 earlier lines dropped]\n").arg(e.total - e.ring.size()));
+    return out;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <algorithm>
+#include <memory>
+
+// Bounded per-job log storage. Each job keeps its most recent lines in a ring
+// buffer; with a spill directory set, every line is also appended to
+// <spillDir>/<id>.log so the full log can be fetched on demand.
+class LogStore : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int kTailLines = 5;         // what the job list shows
+    static constexpr int kMaxLineChars = 1024;   // longer lines are truncated in memory
+    static constexpr int kFinishedLines = 50;    // kept by finished jobs that have no spill file
+
+    explicit LogStore(QObject* parent=nullptr) : QObject(parent) {}
+
+    int capacity() const { return m_capacity; }
+    void setCapacity(int lines) { m_capacity = std::max(kTailLines, lines); }
+    QString spillDir() const { return m_spillDir; }
+    // Logs an earlier session left there are deleted
+    void setSpillDir(const QString& dir);
+
+    void append(const QString& id, const QString& line);
+    // Closes the spill file and shrinks the ring: to the tail for spilled
+    // jobs, to kFinishedLines otherwise.
+    void finish(const QString& id);
+    // Frees the log, in memory and on disk
+    void release(const QString& id);
+    // Deletes spill files of jobs no longer held, e.g. once the report they
+    // were kept for is reset
+    void removeSpill(const QString& id);
+
+    QString tail(const QString& id, int lines = kTailLines) const;
+    QString spillPath(const QString& id) const;
+    Q_INVOKABLE QString fullLog(const QString& id) const;
+
+private:
+    struct Entry {
+        QVector<QString> ring;
+        int head = 0;              // index of the oldest line
+        quint64 total = 0;         // lines ever appended
+        bool finished = false;
+        std::unique_ptr<QFile> spill;
+    };
+    int m_capacity = 200;
+    QString m_spillDir;
+    QHash<QString, std::shared_ptr<Entry>> m_entries;
+
+    static void shrink(Entry& e, int lines);
+    static QStringList lastLines(const Entry& e, int lines);
+};
@@ -0,0 +1,56 @@
+#include "Prefetcher.hpp"
+#include <QFile>
+#include <fcntl.h>
+#include <unistd.h>
+
+Prefetcher::Prefetcher() {
+    // Two readers: enough to overlap a share's latency, few enough not to
+    // compete with the running jobs for the same spindle
+    m_pool.setMaxThreadCount(2);
+}
+
+Prefetcher::~Prefetcher() {
+    for (auto& e : m_entries) *e.stop = true;
+    m_pool.waitForDone();
+}
+
+void Prefetcher::want(const QString& id, const QStringList& files, quint64 size) {
+    if (m_entries.contains(id) || files.isEmpty() || m_budget==0) return;
+    const quint64 left = m_budget > m_reserved ? m_budget - m_reserved : 0;
+    const quint64 bytes = std::min(size, left);
+    if (bytes==0) return;   // over budget; asked again once a prefetched job starts
+
+    Entry e{ std::make_shared<std::atomic<bool>>(false), bytes };
+    m_reserved += bytes;
+    m_entries.insert(id, e);
+    m_pool.start([files, bytes, stop=e.stop]{ warm(files, bytes, *stop); });
+}
+
+void Prefetcher::release(const QString& id) {
+    auto it = m_entries.find(id);
+    if (it==m_entries.end()) return;
+    *it->stop = true;
+    m_reserved -= it->bytes;
+    m_entries.erase(it);
+}
+
+// Plain sequential reads rather than POSIX_FADV_WILLNEED: the hint is
+// advisory, does little on NFS, and can't be paced or stopped once issued.
+void Prefetcher::warm(const QStringList& files, quint64 limit, const std::atomic<bool>& stop) {
+    constexpr size_t kChunk = 1 << 20;
+    std::unique_ptr<char[]> buf(new char[kChunk]);
+    quint64 done = 0;
+    for (const auto& path : files) {
+        const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+        if (fd<0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        off_t off = 0;
+        while (done<limit && !stop) {
+            const ssize_t n = ::pread(fd, buf.get(), size_t(std::min<quint64>(kChunk, limit-done)), off);
+            if (n<=0) break;
+            off += n; done += quint64(n);
+        }
+        ::close(fd);
+        if (done>=limit || stop) break;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+// Warms the page cache with the inputs of jobs that are about to start, so
+// chdman doesn't begin with a cold read from a slow disk or share. Reads run
+// sequentially on a small pool; the bytes reserved for jobs that haven't
+// started yet stay within a budget (jobs larger than what's left get their
+// head warmed). Nothing here touches the disk on the caller's thread.
+class Prefetcher {
+public:
+    Prefetcher();
+    ~Prefetcher();
+
+    void setBudget(quint64 bytes) { m_budget = bytes; }
+    quint64 budget() const { return m_budget; }
+
+    // Starts warming files (size bytes in all) for a job; repeated calls
+    // for the same job are no-ops
+    void want(const QString& id, const QStringList& files, quint64 size);
+    // The job started or was dropped: stop reading for it and return its budget
+    void release(const QString& id);
+    bool has(const QString& id) const { return m_entries.contains(id); }
+
+private:
+    struct Entry { std::shared_ptr<std::atomic<bool>> stop; quint64 bytes = 0; };
+    QHash<QString, Entry> m_entries;
+    quint64 m_budget = 1024ull << 20;
+    quint64 m_reserved = 0;
+    QThreadPool m_pool;
+
+    static void warm(const QStringList& files, quint64 limit, const std::atomic<bool>& stop);
+};
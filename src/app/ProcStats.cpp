@@ -0,0 +1,46 @@
+#include "ProcStats.hpp"
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <unistd.h>
+
+static QByteArray slurp(const QByteArray& path) {
+    QFile f(QString::fromLatin1(path));
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+// Value of "key: <number>" in a /proc key/value file
+static quint64 field(const QByteArray& text, const QByteArray& key) {
+    int at = text.startsWith(key) ? 0 : text.indexOf('\n' + key);
+    if (at<0) return 0;
+    if (at>0) ++at;
+    int i = at + key.size();
+    while (i<text.size() && (text[i]==':' || text[i]==' ' || text[i]=='\t')) ++i;
+    int e = i;
+    while (e<text.size() && text[e]>='0' && text[e]<='9') ++e;
+    return text.mid(i, e-i).toULongLong();
+}
+
+ProcStats::Sample ProcStats::read(qint64 pid) {
+    Sample s;
+    if (pid<=0) return s;
+    const QByteArray base = "/proc/" + QByteArray::number(pid) + '/';
+
+    // comm may contain spaces; fields resume after the last ')'.
+    // utime/stime are fields 14/15, i.e. 12th/13th after the comm.
+    const QByteArray stat = slurp(base + "stat");
+    const int close = stat.lastIndexOf(')');
+    if (close<0) return s;
+    const QList<QByteArray> f = stat.mid(close+2).split(' ');
+    if (f.size()<13) return s;
+    const double tck = double(sysconf(_SC_CLK_TCK));
+    s.userSec = f[11].toULongLong() / tck;
+    s.sysSec  = f[12].toULongLong() / tck;
+
+    s.maxRssKb = field(slurp(base + "status"), "VmHWM");
+    const QByteArray io = slurp(base + "io");   // may be unreadable without ptrace access
+    s.readBytes  = field(io, "rchar");
+    s.writeBytes = field(io, "wchar");
+    s.valid = true;
+    return s;
+}
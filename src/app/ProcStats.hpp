@@ -0,0 +1,14 @@
+#pragma once
+#include <QtGlobal>
+
+// Resource usage of a running process from /proc/<pid>/{stat,status,io}.
+// Readable only while the process exists, so callers sample periodically.
+namespace ProcStats {
+    struct Sample {
+        bool valid = false;
+        double userSec = 0, sysSec = 0;
+        quint64 maxRssKb = 0;                 // VmHWM
+        quint64 readBytes = 0, writeBytes = 0; // rchar/wchar: includes page-cache and NFS I/O
+    };
+    Sample read(qint64 pid);
+}
@@ -0,0 +1,174 @@
+#include "RemoteWorkers.hpp"
+#include "WorkerProtocol.hpp"
+#include <QLocalSocket>
+#include <QTcpSocket>
+
+RemoteWorkers::RemoteWorkers(QObject* parent) : QObject(parent) {
+    m_retry.setInterval(3000);
+    connect(&m_retry, &QTimer::timeout, this, [this]{
+        for (Worker* w : std::as_const(m_workers)) if (!w->io) connectWorker(w);
+    });
+    m_ping.setInterval(WorkerProtocol::kPingMs);
+    connect(&m_ping, &QTimer::timeout, this, [this]{
+        for (Worker* w : std::as_const(m_workers)) {
+            if (!w->io) continue;
+            if (w->heard.elapsed() > WorkerProtocol::kSilenceMs) onLost(w);
+            else if (w->slots>0) w->io->write(WorkerProtocol::encode({{"op", "ping"}}));   // only once past hello
+        }
+    });
+}
+
+RemoteWorkers::~RemoteWorkers() {
+    for (Worker* w : std::as_const(m_workers)) drop(w);
+}
+
+QStringList RemoteWorkers::addresses() const {
+    QStringList out;
+    for (const Worker* w : m_workers) out << w->address;
+    return out;
+}
+
+void RemoteWorkers::setAddresses(const QStringList& addresses) {
+    if (addresses==this->addresses()) return;
+    // Keep the connections that stay; workers removed from the list finish
+    // nothing more for us
+    QList<Worker*> keep;
+    for (Worker* w : std::as_const(m_workers)) {
+        if (addresses.contains(w->address)) { keep << w; continue; }
+        onLost(w);
+        drop(w);
+    }
+    m_workers = keep;
+    for (const auto& a : addresses) {
+        if (a.isEmpty() || std::any_of(m_workers.cbegin(), m_workers.cend(), [&](const Worker* w){ return w->address==a; }))
+            continue;
+        auto w = new Worker{ a };
+        m_workers << w;
+        connectWorker(w);
+    }
+    if (m_workers.isEmpty()) { m_retry.stop(); m_ping.stop(); }
+    else { m_retry.start(); m_ping.start(); }
+    emit capacityChanged();
+}
+
+int RemoteWorkers::totalSlots() const {
+    int n = 0;
+    for (const Worker* w : m_workers) n += w->slots;
+    return n;
+}
+
+int RemoteWorkers::freeSlots() const {
+    int n = 0;
+    for (const Worker* w : m_workers) n += std::max(0, w->slots - int(w->jobs.size()));
+    return n;
+}
+
+QString RemoteWorkers::workerOf(const QString& id) const {
+    const Worker* w = m_owner.value(id);
+    return w ? (w->name.isEmpty() ? w->address : w->name) : QString();
+}
+
+bool RemoteWorkers::submit(const Job& j) {
+    // Largest share of free slots first, so unequal nodes fill evenly
+    Worker* best = nullptr;
+    double bestFree = 0;
+    for (Worker* w : std::as_const(m_workers)) {
+        if (!w->io || w->slots<=0) continue;
+        const double free = double(w->slots - int(w->jobs.size())) / w->slots;
+        if (free>bestFree) { best = w; bestFree = free; }
+    }
+    if (!best) return false;
+    best->io->write(WorkerProtocol::encode({{"op", "run"}, {"job", jobToJson(j)}}));
+    best->jobs.insert(j.id);
+    m_owner.insert(j.id, best);
+    return true;
+}
+
+void RemoteWorkers::cancel(const QString& id) {
+    if (Worker* w = m_owner.value(id); w && w->io)
+        w->io->write(WorkerProtocol::encode({{"op", "cancel"}, {"id", id}}));
+}
+
+void RemoteWorkers::connectWorker(Worker* w) {
+    QIODevice* io = nullptr;
+    if (WorkerProtocol::isLocalSocket(w->address)) {
+        auto s = new QLocalSocket(this);
+        connect(s, &QLocalSocket::connected, this, [this, s]{ s->write(hello()); });
+        connect(s, &QLocalSocket::disconnected, this, [this, w]{ onLost(w); });
+        connect(s, &QLocalSocket::errorOccurred, this, [this, w]{ onLost(w); });
+        s->connectToServer(w->address);
+        io = s;
+    } else {
+        auto s = new QTcpSocket(this);
+        QString host; quint16 port;
+        WorkerProtocol::splitHostPort(w->address, host, port);
+        connect(s, &QTcpSocket::connected, this, [this, s]{ s->write(hello()); });
+        connect(s, &QTcpSocket::disconnected, this, [this, w]{ onLost(w); });
+        connect(s, &QTcpSocket::errorOccurred, this, [this, w]{ onLost(w); });
+        s->setSocketOption(QAbstractSocket::LowDelayOption, 1);   // progress lines are tiny
+        s->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+        s->connectToHost(host, port);
+        io = s;
+    }
+    w->io = io;
+    w->heard.start();
+    connect(io, &QIODevice::readyRead, this, [this, w, io]{
+        if (w->io!=io) return;
+        w->heard.restart();
+        bool tooLong = false;
+        for (const auto& msg : WorkerProtocol::readAll(io, WorkerProtocol::kMaxLine, tooLong)) {
+            onMessage(w, msg);
+            if (w->io!=io) return;   // dropped by the message
+        }
+        if (tooLong) onLost(w);
+    });
+}
+
+QByteArray RemoteWorkers::hello() const {
+    return WorkerProtocol::encode({{"op", "hello"}, {"version", WorkerProtocol::kVersion}, {"token", m_token}});
+}
+
+void RemoteWorkers::onMessage(Worker* w, const QJsonObject& msg) {
+    const QString ev = msg.value("ev").toString();
+    const QString id = msg.value("id").toString();
+    if (ev=="denied") { onLost(w); return; }   // wrong token or version; retried like a drop
+    if (ev=="hello") {
+        if (msg.value("version").toInt()!=WorkerProtocol::kVersion) { onLost(w); return; }
+        w->name = msg.value("name").toString();
+        w->slots = std::max(0, msg.value("slots").toInt());
+        emit capacityChanged();
+        return;
+    }
+    if (!w->jobs.contains(id)) return;   // cancelled and already accounted for
+    if (ev=="started") emit jobStarted(id);
+    else if (ev=="progress") emit jobProgress(id, msg.value("percent").toInt());
+    else if (ev=="ratio") emit jobRatio(id, msg.value("ratio").toDouble());
+    else if (ev=="log") emit jobLog(id, msg.value("line").toString());
+    else if (ev=="info") emit jobInfo(id, msg.value("info").toObject().toVariantMap());
+    else if (ev=="stats") emit jobStats(id, statsFromJson(msg.value("stats").toObject()));
+    else if (ev=="finished") {
+        w->jobs.remove(id);
+        m_owner.remove(id);
+        emit jobFinished(id, msg.value("ok").toBool(), statsFromJson(msg.value("stats").toObject()));
+        emit capacityChanged();
+    }
+}
+
+void RemoteWorkers::onLost(Worker* w) {
+    if (!w->io) return;
+    QIODevice* io = w->io;
+    w->io = nullptr;
+    w->slots = 0;
+    io->disconnect(this);
+    io->deleteLater();
+    const QStringList lost(w->jobs.cbegin(), w->jobs.cend());
+    w->jobs.clear();
+    for (const auto& id : lost) m_owner.remove(id);
+    if (!lost.isEmpty()) emit jobsLost(lost);
+    emit capacityChanged();
+}
+
+void RemoteWorkers::drop(Worker* w) {
+    if (w->io) { w->io->disconnect(this); w->io->deleteLater(); }
+    delete w;
+}
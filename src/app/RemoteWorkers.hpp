@@ -0,0 +1,66 @@
+#pragma once
+#include "Job.hpp"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QIODevice>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVariantMap>
+
+// Coordinator side of the worker protocol: keeps a connection to each
+// opendhc-worker, hands jobs to the one with the most free slots and relays
+// its events under the job's own id. Dropped connections are retried every
+// few seconds, silent ones dropped; the jobs that were out on them are
+// reported through jobsLost().
+class RemoteWorkers : public QObject {
+    Q_OBJECT
+public:
+    explicit RemoteWorkers(QObject* parent=nullptr);
+    ~RemoteWorkers() override;
+
+    QStringList addresses() const;
+    void setAddresses(const QStringList& addresses);
+    // Shared secret presented to workers; used from the next connection on
+    void setToken(const QString& token) { m_token = token; }
+
+    int totalSlots() const;
+    int freeSlots() const;
+    // Sends a job to the least loaded worker; false when all are full
+    bool submit(const Job& j);
+    void cancel(const QString& id);
+    bool owns(const QString& id) const { return m_owner.contains(id); }
+    QString workerOf(const QString& id) const;
+
+signals:
+    void capacityChanged();
+    void jobStarted(const QString& id);
+    void jobProgress(const QString& id, int percent);
+    void jobRatio(const QString& id, double ratioPct);
+    void jobLog(const QString& id, const QString& line);
+    void jobInfo(const QString& id, const QVariantMap& info);
+    void jobStats(const QString& id, const JobStats& stats);
+    void jobFinished(const QString& id, bool ok, const JobStats& stats);
+    void jobsLost(const QStringList& ids);
+
+private:
+    struct Worker {
+        QString address, name;
+        QIODevice* io = nullptr;
+        int slots = 0;             // 0 until the worker said hello
+        QSet<QString> jobs;
+        QElapsedTimer heard;       // since it last sent anything (or we connected)
+    };
+    QList<Worker*> m_workers;
+    QHash<QString, Worker*> m_owner;
+    QTimer m_retry;
+    QTimer m_ping;
+    QString m_token;
+
+    void connectWorker(Worker* w);
+    QByteArray hello() const;
+    void onMessage(Worker* w, const QJsonObject& msg);
+    void onLost(Worker* w);
+    void drop(Worker* w);
+};
@@ -1,44 +1,204 @@
 #include "Report.hpp"
 #include <QString>
 #include <QFile>
+#include <QFileInfo>
 #include <QTextStream>
+#include <QUrl>
+#include <algorithm>
+#include <cmath>
 
-QString Report::asMarkdown() const {
-    QString md;
-    md += "# OpenDHC Final Report\n\n";
-    md += QString("*Total:* %1  •  *OK:* %2  •  *Failed:* %3  •  *Saved:* %4%  \n")
-            .arg(total()).arg(ok()).arg(failed()).arg(QString::number(savedPct(),'f',1));
-    md += QString("*Input:* %1 MB  •  *Output:* %2 MB\n\n")
-            .arg(double(inBytes())/1048576.0,0,'f',1)
-            .arg(double(outBytes())/1048576.0,0,'f',1);
-    md += "## Jobs\n";
+static const char* const kTypeNames[] = { "Create", "Verify", "Info", "Extract", "DeleteSource" };
+
+// QML file dialogs hand us file:// URLs
+static QString localFile(const QString& p) {
+    return p.startsWith("file:") ? QUrl(p).toLocalFile() : p;
+}
+
+static QString csvQuote(QString s) {
+    return '"' + s.replace('"',"\"\"") + '"';
+}
+
+// One-line summary of a native Info result
+static QString infoSummary(const QVariantMap& info) {
+    if (info.contains("error")) return "error: " + info.value("error").toString();
+    return QString("v%1 %2 • %3 MB logical • hunk %4 • %5 • %6 track(s) • SHA1 %7")
+        .arg(info.value("version").toUInt())
+        .arg(info.value("media").toString())
+        .arg(QString::number(info.value("logicalBytes").toULongLong()/1048576.0,'f',1))
+        .arg(info.value("hunkBytes").toUInt())
+        .arg(info.value("compressors").toStringList().join('/'))
+        .arg(info.value("tracks").toStringList().size())
+        .arg(info.value("sha1").toString());
+}
+
+void Report::Breakdown::add(const JobResult& r) {
+    ++total;
+    if (r.ok) ++ok;
+    inBytes += r.inputBytes; outBytes += r.outputBytes; msec += r.msec;
+    if (r.ok && r.msec>0 && r.inputBytes>0)
+        mbps << float(double(r.inputBytes) / 1048576.0 / (double(r.msec) / 1000.0));
+}
+
+// Nearest-rank percentile; only computed when a report is rendered
+double Report::Breakdown::percentileMbps(double p) const {
+    if (mbps.isEmpty()) return 0;
+    QList<float> v = mbps;
+    const auto k = std::clamp<qsizetype>(qsizetype(std::ceil(p / 100.0 * v.size())) - 1, 0, v.size() - 1);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+void Report::add(JobResult r) {
+    // Verify, info and delete steps would count a CHD's size as input that
+    // produced nothing, and their speed as encoding speed
+    if (r.type==JobType::Create || r.type==JobType::Extract) {
+        m_all.add(r);
+        m_byMedia[int(r.media)].add(r);
+    } else if (!r.ok) {
+        ++m_stepsFailed;
+    }
+    m_byType[int(r.type)].add(r);
+    if (auto h = m_hashesFor.constFind(r.id); h!=m_hashesFor.constEnd()) {
+        r.hashes = *h;
+        m_hashesFor.erase(h);
+    }
+    countHashes(r.hashes);
+    m_index.insert(r.id, int(m_items.size()));
+    m_items.push_back(std::move(r));
+    emit updated();
+}
+
+void Report::attachHashes(const QString& id, const QList<Hasher::FileHash>& hashes) {
+    const auto row = m_index.constFind(id);
+    if (row==m_index.constEnd()) { m_hashesFor.insert(id, hashes); return; }
+    JobResult& r = m_items[*row];
+    if (!r.hashes.isEmpty()) return;
+    r.hashes = hashes;
+    countHashes(hashes);
+    emit updated();
+}
+
+void Report::countHashes(const QList<Hasher::FileHash>& hashes) {
+    if (hashes.isEmpty() || hashes.first().match==Hasher::FileHash::NotChecked) return;
+    const bool bad = std::any_of(hashes.cbegin(), hashes.cend(), [](const Hasher::FileHash& h){
+        return !h.ok || h.match==Hasher::FileHash::Mismatch;
+    });
+    const bool matched = std::all_of(hashes.cbegin(), hashes.cend(), [](const Hasher::FileHash& h){
+        return h.match==Hasher::FileHash::Matched;
+    });
+    if (bad) ++m_datFailed;
+    else if (matched) ++m_datMatched;
+}
+
+static const char* matchName(Hasher::FileHash::Match m) {
+    switch (m) {
+        case Hasher::FileHash::Matched: return "match";
+        case Hasher::FileHash::Unknown: return "not in DAT";
+        case Hasher::FileHash::Mismatch: return "MISMATCH";
+        case Hasher::FileHash::NotChecked: break;
+    }
+    return "";
+}
+
+static QString mib(quint64 bytes, int prec = 1) { return QString::number(double(bytes)/1048576.0, 'f', prec); }
+
+static void breakdownRow(QTextStream& ts, const char* name, const Report::Breakdown& b) {
+    if (b.total==0) return;
+    ts << "| " << name << " | " << b.total << " | " << b.ok << " | " << mib(b.inBytes) << " | " << mib(b.outBytes)
+       << " | " << QString::number(b.savedPct(), 'f', 1) << "% | " << QString::number(b.percentileMbps(50), 'f', 1)
+       << " | " << QString::number(b.percentileMbps(90), 'f', 1) << " | " << QString::number(b.percentileMbps(99), 'f', 1)
+       << " |\n";
+}
+
+void Report::writeMarkdown(QTextStream& ts) const {
+    ts << "# OpenDHC Final Report\n\n";
+    ts << "*Conversions:* " << total() << "  •  *OK:* " << ok() << "  •  *Failed jobs:* " << failed()
+       << "  •  *Saved:* " << QString::number(savedPct(),'f',1) << "%  \n";
+    ts << "*Input:* " << mib(inBytes()) << " MB  •  *Output:* " << mib(outBytes()) << " MB";
+    if (m_datMatched || m_datFailed)
+        ts << "  \n*DAT:* " << m_datMatched << " verified  •  " << m_datFailed << " failed";
+    ts << "\n\n";
+
+    ts << "## Breakdown\n";
+    ts << "| | Jobs | OK | In MB | Out MB | Saved | p50 MB/s | p90 MB/s | p99 MB/s |\n";
+    ts << "|---|---|---|---|---|---|---|---|---|\n";
+    breakdownRow(ts, "CD", byMedia(MediaType::CD));
+    breakdownRow(ts, "DVD", byMedia(MediaType::DVD));
+    for (int t=0; t<5; ++t) breakdownRow(ts, kTypeNames[t], m_byType[t]);
+    ts << '\n';
+
+    ts << "## Jobs\n";
     for (auto& i : m_items) {
-        md += QString("- **%1** — %2  \n    - **In:** `%3`  \n    - **Out:** `%4`  \n    - **Size:** %5 ➜ %6 MB  \n    - **Time:** %7 s  \n")
-            .arg(i.ok ? "OK" : "FAILED")
-            .arg(i.status)
-            .arg(i.inputPath).arg(i.outputPath)
-            .arg(QString::number(double(i.inputBytes)/1048576.0,'f',2))
-            .arg(QString::number(double(i.outputBytes)/1048576.0,'f',2))
-            .arg(QString::number(double(i.msec)/1000.0,'f',1));
+        ts << "- **" << (i.ok ? "OK" : "FAILED") << "** — " << i.status << "  \n"
+           << "    - **In:** `" << i.inputPath << "`  \n"
+           << "    - **Out:** `" << i.outputPath << "`  \n"
+           << "    - **Size:** " << mib(i.inputBytes, 2) << " ➜ " << mib(i.outputBytes, 2) << " MB  \n"
+           << "    - **Time:** " << QString::number(double(i.msec)/1000.0,'f',1) << " s  \n";
+        if (!i.info.isEmpty()) ts << "    - **CHD:** " << infoSummary(i.info) << "  \n";
+        if (i.stats.userSec>0 || i.stats.maxRssKb>0)
+            ts << "    - **CPU:** " << QString::number(i.stats.userSec,'f',1) << " s user / "
+               << QString::number(i.stats.sysSec,'f',1) << " s sys  •  **RSS:** "
+               << QString::number(double(i.stats.maxRssKb)/1024.0,'f',0) << " MB  •  **I/O:** "
+               << mib(i.stats.readBytes) << " ➜ " << mib(i.stats.writeBytes) << " MB  •  **Rate:** "
+               << QString::number(i.stats.mbps,'f',1) << " MB/s  \n";
+        if (!i.hashes.isEmpty()) {
+            ts << "    - **Hashes:** " << Hasher::summary(i.hashes) << "  \n";
+            for (const auto& h : i.hashes) {
+                ts << "        - `" << QFileInfo(h.file).fileName() << "` ";
+                if (!h.ok) { ts << "unreadable: " << h.error << "  \n"; continue; }
+                ts << "CRC32 " << h.crcHex() << " • MD5 " << h.md5.toHex() << " • SHA1 " << h.sha1.toHex();
+                if (h.match!=Hasher::FileHash::NotChecked) ts << " — " << matchName(h.match);
+                ts << "  \n";
+            }
+        }
     }
+}
+
+QString Report::asMarkdown() const {
+    QString md;
+    QTextStream ts(&md);
+    writeMarkdown(ts);
+    ts.flush();
     return md;
 }
 
+bool Report::saveMarkdown(const QString& filePath) const {
+    QFile f(localFile(filePath));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    QTextStream ts(&f);
+    ts.setEncoding(QStringConverter::Utf8);
+    writeMarkdown(ts);
+    ts.flush();
+    return f.error()==QFile::NoError;
+}
+
 bool Report::saveCsv(const QString& filePath) const {
-    QFile f(filePath);
+    QFile f(localFile(filePath));
     if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
         return false;
     QTextStream ts(&f);
     ts.setEncoding(QStringConverter::Utf8);
-    ts << "Status,Input,Output,InputMiB,OutputMiB,Millis,ID\n";
+    ts << "Status,Input,Output,InputMiB,OutputMiB,Millis,ID,CHD,"
+          "UserSec,SysSec,MaxRssMiB,ReadMiB,WriteMiB,MiBps,Type,Media,Hashes\n";
     for (const auto& i : m_items) {
         ts << (i.ok ? "OK" : "FAILED") << ','
-           << '"' << i.inputPath.replace('"',"\"\"")  << '"' << ','
-           << '"' << i.outputPath.replace('"',"\"\"") << '"' << ','
+           << csvQuote(i.inputPath) << ','
+           << csvQuote(i.outputPath) << ','
            << QString::number(double(i.inputBytes)/1048576.0, 'f', 3) << ','
            << QString::number(double(i.outputBytes)/1048576.0, 'f', 3) << ','
            << i.msec << ','
-           << i.id << '\n';
+           << i.id << ','
+           << csvQuote(i.info.isEmpty() ? QString() : infoSummary(i.info)) << ','
+           << QString::number(i.stats.userSec, 'f', 2) << ','
+           << QString::number(i.stats.sysSec, 'f', 2) << ','
+           << QString::number(double(i.stats.maxRssKb)/1024.0, 'f', 1) << ','
+           << QString::number(double(i.stats.readBytes)/1048576.0, 'f', 1) << ','
+           << QString::number(double(i.stats.writeBytes)/1048576.0, 'f', 1) << ','
+           << QString::number(i.stats.mbps, 'f', 2) << ','
+           << kTypeNames[int(i.type)] << ','
+           << (i.media==MediaType::DVD ? "DVD" : "CD") << ','
+           << csvQuote(i.hashes.isEmpty() ? QString() : Hasher::summary(i.hashes)) << '\n';
     }
     f.close();
     return true;
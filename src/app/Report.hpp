@@ -1,6 +1,9 @@
 #pragma once
 #include "Job.hpp"
+#include "Hasher.hpp"
+#include <QHash>
 #include <QObject>
+#include <QTextStream>
 
 struct JobResult {
     QString id;
@@ -8,7 +11,13 @@ struct JobResult {
     quint64 inputBytes = 0;
     quint64 outputBytes = 0;
     qint64  msec = 0;
-    QString inputPath, outputPath, status, log;
+    QString inputPath, outputPath, status;
+    QString logFile;   // full log spilled by LogStore, if any
+    QVariantMap info;  // CHD header details from native Info jobs
+    JobStats stats;    // CPU, memory and I/O of the chdman process
+    JobType type{};
+    MediaType media{};
+    QList<Hasher::FileHash> hashes;   // input (create) or output (extract) files, if hashed
 };
 
 class Report : public QObject {
@@ -17,24 +26,68 @@ class Report : public QObject {
     Q_PROPERTY(int ok READ ok NOTIFY updated)
     Q_PROPERTY(int failed READ failed NOTIFY updated)
     Q_PROPERTY(double savedPct READ savedPct NOTIFY updated)
+    Q_PROPERTY(int datMatched READ datMatched NOTIFY updated)
+    Q_PROPERTY(int datFailed READ datFailed NOTIFY updated)
 public:
+    // Running totals for a slice of the results; kept up to date by add()
+    struct Breakdown {
+        int total = 0, ok = 0;
+        quint64 inBytes = 0, outBytes = 0;
+        qint64 msec = 0;
+        QList<float> mbps;   // input MiB/s of each successful timed job
+        double savedPct() const { return inBytes ? 100.0 * (double(inBytes) - double(outBytes)) / double(inBytes) : 0.0; }
+        double percentileMbps(double p) const;
+        void add(const JobResult& r);
+    };
+
     explicit Report(QObject* parent=nullptr):QObject(parent){}
-    void reset(){ m_items.clear(); emit updated(); }
-    void add(JobResult r){ m_items.push_back(std::move(r)); emit updated(); }
-    int total() const { return m_items.size(); }
-    int ok() const { int c=0; for (auto& i : m_items) if (i.ok) ++c; return c; }
-    int failed() const { return total()-ok(); }
-    quint64 inBytes() const { quint64 s=0; for (auto& i:m_items) s+=i.inputBytes; return s; }
-    quint64 outBytes()const { quint64 s=0; for (auto& i:m_items) s+=i.outputBytes; return s; }
-    double savedPct() const {
-        auto ib=inBytes(), ob=outBytes();
-        if (ib==0) return 0.0; return 100.0 * double(ib - ob) / double(ib);
+    Q_INVOKABLE void reset(){
+        QStringList logs;
+        for (const auto& r : std::as_const(m_items)) if (!r.logFile.isEmpty()) logs << r.id;
+        m_items.clear(); m_index.clear(); m_hashesFor.clear(); m_all = {}; m_datMatched = m_datFailed = m_stepsFailed = 0;
+        for (auto& b : m_byMedia) b = {};
+        for (auto& b : m_byType) b = {};
+        emit updated();
+        if (!logs.isEmpty()) emit logsDropped(logs);
     }
+    void add(JobResult r);
+    // Hashes usually finish around the job's own end, before or after add()
+    void attachHashes(const QString& id, const QList<Hasher::FileHash>& hashes);
+    // Conversions (create and extract jobs); other steps are in byType() only
+    int total() const { return m_all.total; }
+    int ok() const { return m_all.ok; }
+    // Failed conversions, plus any other step that failed
+    int failed() const { return total()-ok()+m_stepsFailed; }
+    quint64 inBytes() const { return m_all.inBytes; }
+    quint64 outBytes()const { return m_all.outBytes; }
+    double savedPct() const { return m_all.savedPct(); }
+    // Jobs whose hashed files all match the DAT, and jobs with a mismatch or unreadable file
+    int datMatched() const { return m_datMatched; }
+    int datFailed() const { return m_datFailed; }
+
+    const Breakdown& overall() const { return m_all; }
+    const Breakdown& byMedia(MediaType m) const { return m_byMedia[int(m)]; }
+    const Breakdown& byType(JobType t) const { return m_byType[int(t)]; }
+
+    // Writes piecewise to the stream; nothing the size of the report is built in memory
+    void writeMarkdown(QTextStream& ts) const;
     Q_INVOKABLE QString asMarkdown() const;
+    Q_INVOKABLE bool saveMarkdown(const QString& filePath) const;
     Q_INVOKABLE bool saveCsv(const QString& filePath) const;
 
-signals: void updated();
+signals:
+    void updated();
+    void logsDropped(const QStringList& ids);   // by reset(): jobs whose spilled logs the report held
 
 private:
     QList<JobResult> m_items;
+    QHash<QString, int> m_index;   // id -> m_items row
+    QHash<QString, QList<Hasher::FileHash>> m_hashesFor;   // hashed before their job was added
+    int m_datMatched = 0, m_datFailed = 0;
+
+    void countHashes(const QList<Hasher::FileHash>& hashes);
+    Breakdown m_all;
+    Breakdown m_byMedia[2];
+    Breakdown m_byType[5];   // by JobType
+    int m_stepsFailed = 0;   // failed jobs other than conversions
 };
@@ -0,0 +1,83 @@
+#include "ScanCache.hpp"
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+static constexpr quint32 kMagic = 0x4f444353;   // "ODCS"
+static constexpr quint32 kVersion = 3;   // 2: archives are indexed as inputs; 3: file counts
+
+static QDataStream& operator<<(QDataStream& ds, const ScanCache::Input& i) {
+    return ds << i.name << i.mtime << i.size << i.kind;
+}
+static QDataStream& operator>>(QDataStream& ds, ScanCache::Input& i) {
+    return ds >> i.name >> i.mtime >> i.size >> i.kind;
+}
+static QDataStream& operator<<(QDataStream& ds, const ScanCache::Dir& d) {
+    return ds << d.mtime << d.files << d.subdirs << d.inputs;
+}
+static QDataStream& operator>>(QDataStream& ds, ScanCache::Dir& d) {
+    return ds >> d.mtime >> d.files >> d.subdirs >> d.inputs;
+}
+
+void ScanCache::setFile(const QString& file) {
+    QMutexLocker lock(&m_mutex);
+    if (m_file==file) return;
+    m_file = file;
+    m_dirs.clear(); m_seen.clear();
+    m_loaded = false; m_dirty = false;
+}
+
+bool ScanCache::load() {
+    QMutexLocker lock(&m_mutex);
+    m_seen.clear();
+    if (m_loaded) return true;
+    m_loaded = true;
+    QFile f(m_file);
+    if (m_file.isEmpty() || !f.open(QIODevice::ReadOnly)) return false;
+    QDataStream ds(&f);
+    quint32 magic=0, version=0;
+    ds >> magic >> version;
+    if (magic!=kMagic || version!=kVersion) return false;
+    ds >> m_dirs;
+    if (ds.status()!=QDataStream::Ok) { m_dirs.clear(); return false; }
+    return true;
+}
+
+bool ScanCache::save() {
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty || m_file.isEmpty()) return true;
+    QDir().mkpath(QFileInfo(m_file).absolutePath());
+    QSaveFile f(m_file);
+    if (!f.open(QIODevice::WriteOnly)) return false;
+    QDataStream ds(&f);
+    ds << kMagic << kVersion << m_dirs;
+    if (!f.commit()) return false;
+    m_dirty = false;
+    return true;
+}
+
+std::optional<ScanCache::Dir> ScanCache::lookup(const QByteArray& dir, qint64 mtime) {
+    QMutexLocker lock(&m_mutex);
+    m_seen.insert(dir);
+    auto it = m_dirs.constFind(dir);
+    if (it==m_dirs.constEnd() || it->mtime!=mtime) return std::nullopt;
+    return *it;
+}
+
+void ScanCache::store(const QByteArray& dir, Dir d) {
+    QMutexLocker lock(&m_mutex);
+    m_seen.insert(dir);
+    m_dirs.insert(dir, std::move(d));
+    m_dirty = true;
+}
+
+void ScanCache::prune(const QByteArray& root, bool recursive) {
+    QMutexLocker lock(&m_mutex);
+    const QByteArray prefix = root.endsWith('/') ? root : root + '/';
+    for (auto it = m_dirs.begin(); it!=m_dirs.end(); ) {
+        const bool under = it.key()==root || (recursive && it.key().startsWith(prefix));
+        if (under && !m_seen.contains(it.key())) { it = m_dirs.erase(it); m_dirty = true; }
+        else ++it;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <optional>
+
+// Persistent index of scanned directories, keyed by path. A directory whose
+// mtime has not changed since the last pass is not read again; its
+// subdirectories and candidate inputs are replayed from the index instead.
+class ScanCache {
+public:
+    struct Input { QByteArray name; qint64 mtime = 0; qint64 size = 0; quint8 kind = 0; };
+    struct Dir { qint64 mtime = 0; qint32 files = 0; QList<QByteArray> subdirs; QList<Input> inputs; };   // files: all of them, inputs or not
+
+    explicit ScanCache(const QString& file = QString()) : m_file(file) {}
+
+    QString file() const { return m_file; }
+    void setFile(const QString& file);
+
+    bool load();
+    bool save();
+
+    // Thread-safe; called from scan workers.
+    std::optional<Dir> lookup(const QByteArray& dir, qint64 mtime);
+    void store(const QByteArray& dir, Dir d);
+
+    // Forget directories in the scope of a walk from root (root itself, or
+    // its whole subtree when recursive) that were not visited since load().
+    void prune(const QByteArray& root, bool recursive);
+
+private:
+    QString m_file;
+    QMutex m_mutex;
+    QHash<QByteArray, Dir> m_dirs;
+    QSet<QByteArray> m_seen;
+    bool m_loaded = false;
+    bool m_dirty = false;
+};
@@ -1,23 +1,91 @@
 #pragma once
 #include <QObject>
 #include <QSettings>
+#include <QFileInfo>
+#include <QRegularExpression>
 
 class Settings : public QObject {
     Q_OBJECT
     Q_PROPERTY(QString chdmanPath READ chdmanPath WRITE setChdmanPath NOTIFY changed)
     Q_PROPERTY(QString outputDir READ outputDir WRITE setOutputDir NOTIFY changed)
     Q_PROPERTY(int concurrency READ concurrency WRITE setConcurrency NOTIFY changed)
+    Q_PROPERTY(int perDeviceLimit READ perDeviceLimit WRITE setPerDeviceLimit NOTIFY changed)
+    Q_PROPERTY(int queuePolicy READ queuePolicy WRITE setQueuePolicy NOTIFY changed)
+    Q_PROPERTY(int threadBudget READ threadBudget WRITE setThreadBudget NOTIFY changed)
+    Q_PROPERTY(bool boostTail READ boostTail WRITE setBoostTail NOTIFY changed)
+    Q_PROPERTY(int prefetchDepth READ prefetchDepth WRITE setPrefetchDepth NOTIFY changed)
+    Q_PROPERTY(int prefetchBudgetMiB READ prefetchBudgetMiB WRITE setPrefetchBudgetMiB NOTIFY changed)
+    Q_PROPERTY(QString stagingDir READ stagingDir WRITE setStagingDir NOTIFY changed)
+    Q_PROPERTY(int stagingBudgetMiB READ stagingBudgetMiB WRITE setStagingBudgetMiB NOTIFY changed)
+    Q_PROPERTY(QString unpackDir READ unpackDir WRITE setUnpackDir NOTIFY changed)
+    Q_PROPERTY(int unpackBudgetMiB READ unpackBudgetMiB WRITE setUnpackBudgetMiB NOTIFY changed)
+    Q_PROPERTY(int spaceMarginMiB READ spaceMarginMiB WRITE setSpaceMarginMiB NOTIFY changed)
+    Q_PROPERTY(bool scanArchives READ scanArchives WRITE setScanArchives NOTIFY changed)
+    Q_PROPERTY(QString datFile READ datFile WRITE setDatFile NOTIFY changed)
+    Q_PROPERTY(bool hashInputs READ hashInputs WRITE setHashInputs NOTIFY changed)
+    Q_PROPERTY(QString workers READ workers WRITE setWorkers NOTIFY changed)
+    Q_PROPERTY(QString workerToken READ workerToken WRITE setWorkerToken NOTIFY changed)
+    Q_PROPERTY(QString cdProfile READ cdProfile WRITE setCdProfile NOTIFY changed)
+    Q_PROPERTY(QString dvdProfile READ dvdProfile WRITE setDvdProfile NOTIFY changed)
 public:
     explicit Settings(QObject* parent=nullptr) : QObject(parent), s("OpenDHC","OpenDHC") {}
 
     QString chdmanPath() const { return s.value("chdmanPath").toString(); }
     QString outputDir()  const { return s.value("outputDir").toString(); }
     int concurrency()    const { return s.value("concurrency", 2).toInt(); }
+    int perDeviceLimit() const { return s.value("perDeviceLimit", 0).toInt(); }
+    int queuePolicy()    const { return s.value("queuePolicy", 0).toInt(); }
+    int threadBudget()   const { return s.value("threadBudget", 0).toInt(); }
+    bool boostTail()     const { return s.value("boostTail", true).toBool(); }
+    int prefetchDepth()     const { return s.value("prefetchDepth", 2).toInt(); }
+    int prefetchBudgetMiB() const { return s.value("prefetchBudgetMiB", 1024).toInt(); }
+    QString stagingDir()    const { return s.value("stagingDir").toString(); }   // empty = write in place
+    int stagingBudgetMiB()  const { return s.value("stagingBudgetMiB", 0).toInt(); }
+    QString unpackDir()     const { return s.value("unpackDir").toString(); }   // empty = temp dir
+    int unpackBudgetMiB()   const { return s.value("unpackBudgetMiB", 8192).toInt(); }
+    int spaceMarginMiB()    const { return s.value("spaceMarginMiB", 1024).toInt(); }   // kept free on output filesystems
+    bool scanArchives()     const { return s.value("scanArchives", false).toBool(); }
+    // Redump/No-Intro DAT to check hashed files against; with a DAT loaded,
+    // files are hashed even when hashInputs is off
+    QString datFile()       const { return s.value("datFile").toString(); }
+    bool hashInputs()       const { return s.value("hashInputs", false).toBool(); }
+    // opendhc-worker addresses, separated by spaces or commas
+    QString workers()       const { return s.value("workers").toString(); }
+    QStringList workerList() const { return workers().split(QRegularExpression("[,\\s]+"), Qt::SkipEmptyParts); }
+    // Shared secret the workers were started with (--token)
+    QString workerToken()   const { return s.value("workerToken").toString(); }
+    // Default -c/-hs for create jobs, e.g. "-c cdzl,cdfl -hs 9792"
+    QString cdProfile()  const { return s.value("cdProfile").toString(); }
+    QString dvdProfile() const { return s.value("dvdProfile").toString(); }
+
+    // Persistent batch scan index, stored next to the settings file
+    QString scanIndexFile() const { return QFileInfo(s.fileName()).absolutePath() + "/scan-index.bin"; }
+    // Journal of the current batch, for resuming it after a crash
+    QString journalFile() const { return QFileInfo(s.fileName()).absolutePath() + "/journal.log"; }
 
 public slots:
     void setChdmanPath(const QString& v) { s.setValue("chdmanPath", v); emit changed(); }
     void setOutputDir(const QString& v)  { s.setValue("outputDir", v); emit changed(); }
     void setConcurrency(int v)           { s.setValue("concurrency", v); emit changed(); }
+    void setPerDeviceLimit(int v)        { s.setValue("perDeviceLimit", v); emit changed(); }
+    void setQueuePolicy(int v)           { s.setValue("queuePolicy", v); emit changed(); }
+    void setThreadBudget(int v)          { s.setValue("threadBudget", v); emit changed(); }
+    void setBoostTail(bool v)            { s.setValue("boostTail", v); emit changed(); }
+    void setPrefetchDepth(int v)         { s.setValue("prefetchDepth", v); emit changed(); }
+    void setPrefetchBudgetMiB(int v)     { s.setValue("prefetchBudgetMiB", v); emit changed(); }
+    void setStagingDir(const QString& v) { s.setValue("stagingDir", v); emit changed(); }
+    void setStagingBudgetMiB(int v)      { s.setValue("stagingBudgetMiB", v); emit changed(); }
+    void setUnpackDir(const QString& v)  { s.setValue("unpackDir", v); emit changed(); }
+    void setUnpackBudgetMiB(int v)       { s.setValue("unpackBudgetMiB", v); emit changed(); }
+    void setSpaceMarginMiB(int v)        { s.setValue("spaceMarginMiB", v); emit changed(); }
+    void setScanArchives(bool v)         { s.setValue("scanArchives", v); emit changed(); }
+    void setDatFile(const QString& v)    { s.setValue("datFile", v); emit changed(); }
+    void setHashInputs(bool v)           { s.setValue("hashInputs", v); emit changed(); }
+    void setWorkers(const QString& v)    { s.setValue("workers", v); emit changed(); }
+    void setWorkerToken(const QString& v) { s.setValue("workerToken", v); emit changed(); }
+    void setCdProfile(const QString& v)  { s.setValue("cdProfile", v); emit changed(); }
+    void setDvdProfile(const QString& v) { s.setValue("dvdProfile", v); emit changed(); }
+    void setProfile(int media, const QString& v) { media==1 ? setDvdProfile(v) : setCdProfile(v); }
 
 signals:
     void changed();
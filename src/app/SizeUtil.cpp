@@ -1,8 +1,13 @@
 #include "SizeUtil.hpp"
+#include "Archive.hpp"
 #include <QFileInfo>
 #include <QFile>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
 #include <QTextStream>
 #include <QDir>
+#include <QRegularExpression>
 using u64 = quint64;
 
 u64 SizeUtil::safeFileSize(const QString& p) {
@@ -10,47 +15,100 @@ u64 SizeUtil::safeFileSize(const QString& p) {
     return fi.exists() ? static_cast<u64>(fi.size()) : 0;
 }
 
-static u64 sumCue(const QString& cuePath){
+// First quoted name on a line, or the bare word following the keyword
+static QString quotedOrWord(const QString& line, int from) {
+    int a = line.indexOf('"', from), b = line.indexOf('"', a+1);
+    if (a>=0 && b>a) return line.mid(a+1, b-a-1);
+    return line.mid(from).trimmed().section(' ', 0, 0);
+}
+
+static void cueFiles(const QString& cuePath, QStringList& out){
     QFile f(cuePath);
-    if (!f.open(QIODevice::ReadOnly|QIODevice::Text)) return 0;
+    if (!f.open(QIODevice::ReadOnly|QIODevice::Text)) return;
     QTextStream ts(&f);
     QDir dir(QFileInfo(cuePath).dir());
-    u64 total=0;
     while(!ts.atEnd()){
         const auto line = ts.readLine().trimmed();
-        if (line.startsWith("FILE ", Qt::CaseInsensitive)) {
-            int a = line.indexOf('"'), b = line.lastIndexOf('"');
-            if (a>=0 && b>a) {
-                const auto fname = line.mid(a+1, b-a-1);
-                total += SizeUtil::safeFileSize(dir.filePath(fname));
-            }
-        }
+        if (!line.startsWith("FILE ", Qt::CaseInsensitive)) continue;
+        // FILE "name" BINARY: the type follows the last quote
+        int a = line.indexOf('"'), b = line.lastIndexOf('"');
+        if (a>=0 && b>a) out << dir.filePath(line.mid(a+1, b-a-1));
     }
-    return total;
 }
 
-static u64 sumGdi(const QString& gdiPath){
+// TOC files (cdrdao) name their data as FILE "x" ... or DATAFILE "x" ...
+static void tocFiles(const QString& tocPath, QStringList& out){
+    QFile f(tocPath);
+    if (!f.open(QIODevice::ReadOnly|QIODevice::Text)) return;
+    QTextStream ts(&f);
+    QDir dir(QFileInfo(tocPath).dir());
+    while(!ts.atEnd()){
+        const auto line = ts.readLine().trimmed();
+        int from = -1;
+        if (line.startsWith("FILE ", Qt::CaseInsensitive)) from = 5;
+        else if (line.startsWith("DATAFILE ", Qt::CaseInsensitive)) from = 9;
+        if (from<0) continue;
+        const QString name = quotedOrWord(line, from);
+        const QString path = dir.filePath(name);
+        if (!name.isEmpty() && !out.contains(path)) out << path;
+    }
+}
+
+static void gdiFiles(const QString& gdiPath, QStringList& out){
     QFile f(gdiPath);
-    if (!f.open(QIODevice::ReadOnly|QIODevice::Text)) return 0;
+    if (!f.open(QIODevice::ReadOnly|QIODevice::Text)) return;
     QTextStream ts(&f);
     QDir dir(QFileInfo(gdiPath).dir());
-    u64 total=0;
+    static const QRegularExpression ws("\\s+");
     while(!ts.atEnd()){
         const auto line = ts.readLine().trimmed();
         if (line.isEmpty() || !line[0].isDigit()) continue;
-        const auto parts = line.split(QRegExp("\\s+"));
+        const auto parts = line.split(ws);
         if (parts.size()>=6) {
-            QString fname = parts.at(5);
-            if (fname.startsWith('"') && fname.endsWith('"')) fname = fname.mid(1, fname.size()-2);
-            total += SizeUtil::safeFileSize(dir.filePath(fname));
+            QString fname = parts.at(4);
+            if (fname.startsWith('"')) fname = quotedOrWord(line, line.indexOf('"'));
+            out << dir.filePath(fname);
         }
     }
-    return total;
+}
+
+QStringList SizeUtil::trackFiles(const QString& input){
+    QStringList out;
+    QString archive;
+    if (Archive::split(input, &archive, nullptr)) return { archive };   // all reads go to the archive
+    const auto ext = QFileInfo(input).suffix().toLower();
+    if (ext=="cue") cueFiles(input, out);
+    else if (ext=="gdi") gdiFiles(input, out);
+    else if (ext=="toc") tocFiles(input, out);
+    else out << input;
+    return out;
+}
+
+// Listing of an archive, read once for all the discs in it while the archive
+// is unchanged. Callers run on worker pools, hence the lock.
+static QList<Archive::Member> archiveListing(const QString& archive) {
+    struct Listing { QDateTime mtime; qint64 size = 0; QList<Archive::Member> members; };
+    static QMutex mutex;
+    static QHash<QString, Listing> cache;
+    const QFileInfo fi(archive);
+    const QDateTime mtime = fi.lastModified();
+    {
+        QMutexLocker lock(&mutex);
+        auto it = cache.constFind(archive);
+        if (it!=cache.constEnd() && it->mtime==mtime && it->size==fi.size()) return it->members;
+    }
+    Listing l{ mtime, fi.size(), Archive::list(archive) };
+    QMutexLocker lock(&mutex);
+    if (cache.size() >= 256) cache.clear();   // batches move from archive to archive
+    cache.insert(archive, l);
+    return l.members;
 }
 
 u64 SizeUtil::estimateInputBytes(const Job& j){
-    const auto ext = QFileInfo(j.inputPath).suffix().toLower();
-    if (ext=="cue") return sumCue(j.inputPath);
-    if (ext=="gdi") return sumGdi(j.inputPath);
-    return safeFileSize(j.inputPath);
+    QString archive, member;
+    if (Archive::split(j.inputPath, &archive, &member))
+        return Archive::footprint(archiveListing(archive), member);
+    u64 total = 0;
+    for (const auto& f : trackFiles(j.inputPath)) total += safeFileSize(f);
+    return total;
 }
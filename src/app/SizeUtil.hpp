@@ -1,9 +1,15 @@
 #pragma once
 #include "Job.hpp"
 #include <QString>
+#include <QStringList>
 #include <QtGlobal>
 
 namespace SizeUtil {
+    // Blocking file system access; keep off the GUI thread
     quint64 estimateInputBytes(const Job& j);
     quint64 safeFileSize(const QString& path);
+    // Files holding an input's data: the tracks a .cue/.gdi/.toc references
+    // (in order, without the descriptor itself), the input for an image, or
+    // the archive holding an "archive#member" input.
+    QStringList trackFiles(const QString& input);
 }
@@ -0,0 +1,194 @@
+#include "WatchFolder.hpp"
+#include "Archive.hpp"
+#include "SizeUtil.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint32_t kDirMask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MODIFY | IN_DELETE
+                                   | IN_MOVED_FROM | IN_ONLYDIR | IN_DONTFOLLOW | IN_EXCL_UNLINK;
+
+WatchFolder::WatchFolder(QObject* parent) : QObject(parent) {
+    m_check.setInterval(500);
+    connect(&m_check, &QTimer::timeout, this, &WatchFolder::checkPending);
+    m_listPool.setMaxThreadCount(2);
+}
+
+WatchFolder::~WatchFolder() {
+    stop();
+    m_listPool.waitForDone();
+}
+
+void WatchFolder::setSettleMs(int ms) {
+    ms = std::max(0, ms);
+    if (m_settleMs==ms) return;
+    m_settleMs = ms;
+    emit settleMsChanged();
+}
+
+bool WatchFolder::start(QStringList roots, bool recursive, bool includeCD, bool includeDVD, bool includeArchives) {
+    stop();
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd<0) { emit error(QString("inotify: ") + strerror(errno)); return false; }
+    m_recursive = recursive; m_cd = includeCD; m_dvd = includeDVD;
+    m_archives = includeArchives && Archive::supported();
+    for (auto& r : roots) {
+        if (r.startsWith("file:")) r = QUrl(r).toLocalFile();   // from a QML dialog
+        r = QDir::cleanPath(QFileInfo(r).absoluteFilePath());
+    }
+    m_roots = roots;
+    for (const auto& r : std::as_const(m_roots)) addTree(r, r, false);
+    m_notifier = std::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Read);
+    connect(m_notifier.get(), &QSocketNotifier::activated, this, &WatchFolder::readEvents);
+    emit watchingChanged();
+    return true;
+}
+
+void WatchFolder::stop() {
+    if (m_fd<0) return;
+    m_notifier.reset();
+    ::close(m_fd);
+    m_fd = -1;
+    m_check.stop();
+    m_dirs.clear(); m_pending.clear(); m_parked.clear(); m_reported.clear(); m_roots.clear();
+    ++m_session;
+    emit watchingChanged();
+}
+
+QString WatchFolder::rootOf(const QString& dir) const {
+    QString best;
+    for (const auto& r : m_roots)
+        if ((dir==r || dir.startsWith(r + '/')) && r.size()>best.size()) best = r;
+    return best;
+}
+
+bool WatchFolder::candidate(const QString& name) const {
+    const QString ext = QFileInfo(name).suffix().toLower();
+    if (ext=="cue" || ext=="toc" || ext=="gdi") return m_cd;
+    if (ext=="iso") return m_dvd;
+    return m_archives && Archive::isArchive(name);
+}
+
+// Watches dir and (when recursive) everything below it. With seedExisting,
+// files already there are treated as new: a folder moved or copied in
+// brings its discs with it, before our watch on it exists.
+void WatchFolder::addTree(const QString& dir, const QString& root, bool seedExisting) {
+    const int wd = inotify_add_watch(m_fd, QFile::encodeName(dir).constData(), kDirMask);
+    if (wd<0) {
+        emit error(errno==ENOSPC ? "inotify watch limit reached (fs.inotify.max_user_watches): " + dir
+                                 : "Cannot watch " + dir + ": " + strerror(errno));
+        return;
+    }
+    m_dirs.insert(wd, dir);
+    const QDir d(dir);
+    if (seedExisting)
+        for (const auto& f : d.entryList(QDir::Files | QDir::NoDotAndDotDot)) touched(dir, f, root);
+    if (m_recursive)
+        for (const auto& sub : d.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+            addTree(d.filePath(sub), root, seedExisting);
+}
+
+void WatchFolder::readEvents() {
+    alignas(inotify_event) char buf[64 * 1024];
+    for (;;) {
+        const ssize_t n = ::read(m_fd, buf, sizeof buf);
+        if (n<=0) break;   // EAGAIN: drained
+        for (char* p = buf; p < buf + n; ) {
+            const auto* ev = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Events were lost: look at every watched directory once
+                for (const auto& r : std::as_const(m_roots)) addTree(r, r, true);
+                continue;
+            }
+            if (ev->mask & IN_IGNORED) { m_dirs.remove(ev->wd); continue; }
+            const QString dir = m_dirs.value(ev->wd);
+            if (dir.isEmpty() || ev->len==0) continue;
+            const QString name = QFile::decodeName(ev->name);
+            if (ev->mask & IN_ISDIR) {
+                if (m_recursive && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                    addTree(QDir(dir).filePath(name), rootOf(dir), true);
+                continue;
+            }
+            touched(dir, name, rootOf(dir));
+        }
+    }
+}
+
+// A file changed: it may be a new disc, or part of one we are waiting for
+void WatchFolder::touched(const QString& dir, const QString& name, const QString& root) {
+    const QString path = QDir(dir).filePath(name);
+    const QString parked = m_parked.take(path);
+    for (const QString& input : { candidate(name) ? path : QString(), parked }) {
+        if (input.isEmpty() || m_pending.contains(input)) continue;
+        Pending p;
+        p.root = input==path ? root : rootOf(QFileInfo(input).path());
+        p.quiet.start();
+        m_pending.insert(input, std::move(p));
+    }
+    for (auto& p : m_pending)
+        if (p.sizes.contains(path)) p.quiet.restart();
+    if (!m_pending.isEmpty() && !m_check.isActive()) m_check.start();
+}
+
+static qint64 fileSize(const QString& path, qint64* mtime = nullptr) {
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st)!=0 || !S_ISREG(st.st_mode)) return -1;
+    if (mtime) *mtime = qint64(st.st_mtim.tv_sec)*1000000000 + st.st_mtim.tv_nsec;
+    return st.st_size;
+}
+
+void WatchFolder::checkPending() {
+    QHash<QString, QStringList> ready;   // root -> inputs
+    for (auto it = m_pending.begin(); it!=m_pending.end(); ) {
+        const QString& input = it.key();
+        Pending& p = it.value();
+        qint64 mtime = 0;
+        if (fileSize(input, &mtime)<0) { it = m_pending.erase(it); continue; }   // gone again
+        QHash<QString, qint64> sizes;
+        sizes.insert(input, fileSize(input));
+        if (!Archive::isArchive(input))
+            for (const auto& f : SizeUtil::trackFiles(input)) sizes.insert(f, fileSize(f));
+        if (sizes!=p.sizes) { p.sizes = std::move(sizes); p.quiet.restart(); ++it; continue; }
+        const bool complete = std::none_of(p.sizes.cbegin(), p.sizes.cend(), [](qint64 s){ return s<0; });
+        if (!complete && p.quiet.elapsed() >= kStaleMs) {
+            for (auto s = p.sizes.cbegin(); s!=p.sizes.cend(); ++s)
+                if (s.value()<0) m_parked.insert(s.key(), input);
+            it = m_pending.erase(it);
+            continue;
+        }
+        if (!complete || p.quiet.elapsed() < m_settleMs) { ++it; continue; }
+
+        if (m_reported.value(input, -1)!=mtime) {
+            m_reported.insert(input, mtime);
+            if (!Archive::isArchive(input)) ready[p.root] << input;
+            else listArchive(input, p.root);
+        }
+        it = m_pending.erase(it);
+    }
+    if (m_pending.isEmpty()) m_check.stop();
+    for (auto r = ready.cbegin(); r!=ready.cend(); ++r) emit inputsReady(r.value(), r.key());
+}
+
+// Reports the discs inside a settled archive. Listing it reads the central
+// directory, which can take a while on a share, so it runs on the pool.
+void WatchFolder::listArchive(const QString& archive, const QString& root) {
+    m_listPool.start([this, archive, root, session = m_session]{
+        const auto members = Archive::list(archive);
+        QMetaObject::invokeMethod(this, [this, archive, root, session, members]{
+            if (session!=m_session) return;
+            QStringList inputs;
+            for (const auto& m : members)
+                if (candidate(QFileInfo(m.name).fileName()) && !Archive::isArchive(m.name))
+                    inputs << archive + '#' + m.name;
+            if (!inputs.isEmpty()) emit inputsReady(inputs, root);
+        }, Qt::QueuedConnection);
+    });
+}
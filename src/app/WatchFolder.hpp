@@ -0,0 +1,69 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+
+// Watches source folders with inotify and reports each disc once its file
+// set is complete: the descriptor and every track it names exist and none of
+// them has changed for settleMs. Only directories that see events are
+// looked at again; the tree is never rescanned, except after an inotify
+// queue overflow. Discs already present when watching starts are left to a
+// regular scan. A disc still missing files after kStaleMs is no longer
+// polled; the arrival of one of those files brings it back.
+class WatchFolder : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(bool watching READ watching NOTIFY watchingChanged)
+    Q_PROPERTY(int settleMs READ settleMs WRITE setSettleMs NOTIFY settleMsChanged)
+public:
+    static constexpr int kStaleMs = 10 * 60 * 1000;
+
+    explicit WatchFolder(QObject* parent=nullptr);
+    ~WatchFolder() override;
+
+    Q_INVOKABLE bool start(QStringList roots, bool recursive, bool includeCD, bool includeDVD,
+                           bool includeArchives = false);
+    Q_INVOKABLE void stop();
+    bool watching() const { return m_fd>=0; }
+
+    int settleMs() const { return m_settleMs; }
+    void setSettleMs(int ms);
+
+signals:
+    void watchingChanged();
+    void settleMsChanged();
+    void inputsReady(const QStringList& inputs, const QString& root);
+    void error(const QString& message);
+
+private:
+    struct Pending {
+        QString root;
+        QHash<QString, qint64> sizes;   // file -> size at the last check; -1 = missing
+        QElapsedTimer quiet;            // since anything in the set last changed
+    };
+    int m_fd = -1;
+    std::unique_ptr<QSocketNotifier> m_notifier;
+    QTimer m_check;
+    int m_settleMs = 3000;
+    bool m_recursive = true, m_cd = true, m_dvd = true, m_archives = false;
+    QStringList m_roots;
+    QHash<int, QString> m_dirs;          // watch descriptor -> directory
+    QHash<QString, Pending> m_pending;   // descriptor/image -> its file set
+    QHash<QString, QString> m_parked;    // missing file -> stale disc waiting for it
+    QHash<QString, qint64> m_reported;   // input -> mtime when reported
+    QThreadPool m_listPool;              // archive listings: they read the whole directory
+    int m_session = 0;                   // bumped by stop(), so late listings are dropped
+
+    void addTree(const QString& dir, const QString& root, bool seedExisting);
+    void readEvents();
+    void touched(const QString& dir, const QString& name, const QString& root);
+    void checkPending();
+    void listArchive(const QString& archive, const QString& root);
+    bool candidate(const QString& name) const;
+    QString rootOf(const QString& dir) const;
+};
@@ -0,0 +1,43 @@
+#include "WorkerProtocol.hpp"
+#include <QJsonDocument>
+
+QByteArray WorkerProtocol::encode(const QJsonObject& msg) {
+    return QJsonDocument(msg).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QList<QJsonObject> WorkerProtocol::readAll(QIODevice* dev, qint64 maxLine, bool& tooLong) {
+    QList<QJsonObject> out;
+    tooLong = false;
+    while (dev->canReadLine()) {
+        const QByteArray line = dev->readLine(maxLine + 1);
+        if (line.size()>maxLine) { tooLong = true; return out; }
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (doc.isObject()) out << doc.object();
+    }
+    tooLong = dev->bytesAvailable() > maxLine;
+    return out;
+}
+
+bool WorkerProtocol::allowedArgs(const QStringList& args, QString* bad) {
+    static const QStringList flags = { "-f", "--force" };
+    static const QStringList valued = { "-c", "--compression", "-hs", "--hunksize", "-np", "--numprocessors" };
+    for (int i=0; i<args.size(); ++i) {
+        if (flags.contains(args[i])) continue;
+        if (valued.contains(args[i]) && i+1<args.size() && !args[i+1].startsWith('-')) { ++i; continue; }
+        if (bad) *bad = args[i];
+        return false;
+    }
+    return true;
+}
+
+bool WorkerProtocol::isLocalSocket(const QString& address) {
+    return address.startsWith('/');
+}
+
+void WorkerProtocol::splitHostPort(const QString& address, QString& host, quint16& port) {
+    const int colon = address.lastIndexOf(':');
+    bool ok = false;
+    const uint p = colon>0 ? address.mid(colon+1).toUInt(&ok) : 0;
+    host = (ok && p>0 && p<65536) ? address.left(colon) : address;
+    port = (ok && p>0 && p<65536) ? quint16(p) : kDefaultPort;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <QByteArray>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Wire format between a coordinator (ChdmanRunner) and opendhc-worker: one
+// compact JSON object per line, over TCP ("host:port") or a Unix socket
+// (an absolute path).
+//
+//   coordinator -> worker
+//     {"op":"hello", "version":2, "token":...}   first, before anything else
+//     {"op":"run", "job":{...}}                  see jobToJson()
+//     {"op":"cancel", "id":...}
+//     {"op":"ping"}                              every kPingMs
+//   worker -> coordinator
+//     {"ev":"hello", "version":2, "name":..., "slots":n}   once the token matched
+//     {"ev":"denied"}                                      otherwise, then it hangs up
+//     {"ev":"pong"}
+//     {"ev":"started"|"progress"|"ratio"|"log"|"info"|"stats"|"finished", "id":..., ...}
+//
+// A worker the coordinator hasn't heard from in kSilenceMs counts as lost,
+// so a dead host or a cut network gives its jobs back in seconds rather
+// than when TCP gives up. The token is a shared secret, not encryption: outside a trusted network,
+// tunnel the connection (e.g. over SSH). Workers only run single chdman
+// steps with a fixed set of options; pipelines and deletions stay local.
+// Jobs are run against shared storage: paths are sent as they are, so every
+// node must mount the inputs and outputs under the same names.
+namespace WorkerProtocol {
+    constexpr int kVersion = 2;
+    constexpr quint16 kDefaultPort = 7411;
+    constexpr int kPingMs = 5000;
+    constexpr int kSilenceMs = 20000;
+    constexpr qint64 kMaxHelloLine = 64 << 10;   // before a peer proved the token
+    constexpr qint64 kMaxLine = 16 << 20;
+
+    QByteArray encode(const QJsonObject& msg);
+    // Complete lines available on the device; malformed lines are dropped.
+    // A line past maxLine (complete or not) sets tooLong and ends the read:
+    // the peer is to be hung up on rather than buffered without end.
+    QList<QJsonObject> readAll(QIODevice* dev, qint64 maxLine, bool& tooLong);
+
+    // Whether a worker runs chdman with these extra arguments: compression
+    // settings, threads and -f only, nothing that names another file (such
+    // as -ob). The first one refused goes to *bad.
+    bool allowedArgs(const QStringList& args, QString* bad = nullptr);
+
+    // "host:port", "host" (default port) or a Unix socket path
+    bool isLocalSocket(const QString& address);
+    void splitHostPort(const QString& address, QString& host, quint16& port);
+}
@@ -0,0 +1,412 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "app/Archive.hpp"
+#include "app/BatchScanner.hpp"
+#include "app/ChdmanRunner.hpp"
+#include "app/CodecTuner.hpp"
+#include "app/Dedup.hpp"
+#include "app/HashVerifier.hpp"
+#include "app/JobJournal.hpp"
+#include "app/Report.hpp"
+#include "app/Settings.hpp"
+#include "app/WatchFolder.hpp"
+
+// SIGINT/SIGTERM reach the event loop through a pipe; a second one ends the
+// process at once
+static int stopPipe[2] = { -1, -1 };
+static void onStopSignal(int) {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    const char c = 1;
+    (void)!::write(stopPipe[1], &c, 1);
+}
+
+// One JSON object per line on stdout, flushed so pipes see it immediately
+static void emitEvent(const QString& event, QJsonObject o) {
+    o.insert("event", event);
+    o.insert("ts", QDateTime::currentMSecsSinceEpoch());
+    const QByteArray line = QJsonDocument(o).toJson(QJsonDocument::Compact) + '\n';
+    std::fwrite(line.constData(), 1, size_t(line.size()), stdout);
+    std::fflush(stdout);
+}
+
+static bool parseJobType(const QString& s, JobType& t) {
+    const QString v = s.toLower();
+    if (v=="create")  { t = JobType::Create;  return true; }
+    if (v=="verify")  { t = JobType::Verify;  return true; }
+    if (v=="info")    { t = JobType::Info;    return true; }
+    if (v=="extract") { t = JobType::Extract; return true; }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("OpenDHC");
+    QCoreApplication::setApplicationName("OpenDHC");
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("Headless OpenDHC batch converter. Progress is written to stdout as JSON lines.");
+    cli.addHelpOption();
+    cli.addPositionalArgument("sources", "Input files or folders to scan.", "<source>...");
+    QCommandLineOption typeOpt({"t","type"}, "Job type: create, verify, info or extract (default create).", "type", "create");
+    QCommandLineOption outOpt({"o","output"}, "Output root (default: current directory).", "dir", ".");
+    QCommandLineOption concOpt({"j","concurrency"}, "Concurrent chdman processes (default: from settings).", "n");
+    QCommandLineOption chdmanOpt("chdman", "Path to chdman (default: from settings, then PATH).", "path");
+    QCommandLineOption extraOpt("extra", "Extra chdman arguments, space separated.", "args");
+    QCommandLineOption flatOpt("flat", "Do not mirror the source folder structure under the output root.");
+    QCommandLineOption noRecOpt("no-recursive", "Only scan the top level of source folders.");
+    QCommandLineOption noCdOpt("no-cd", "Skip CD inputs (.cue/.toc/.gdi).");
+    QCommandLineOption noDvdOpt("no-dvd", "Skip DVD inputs (.iso).");
+    QCommandLineOption skipOpt("skip-up-to-date", "Skip inputs whose output exists and is newer.");
+    QCommandLineOption verifyOpt("verify", "Verify each created CHD as a follow-up job.");
+    QCommandLineOption delOpt("delete-source", "Delete the input (and its track files) once the job succeeded; "
+                                               "created CHDs are verified first.");
+    QCommandLineOption dedupOpt("dedup", "Convert byte-identical inputs in scanned folders only once.");
+    QCommandLineOption linkOpt("link-duplicates", "With --dedup, hard-link (or symlink) each duplicate's output "
+                                                  "to the converted copy.");
+    QCommandLineOption stageOpt("staging", "Write CHDs to this local scratch folder first, then move them "
+                                           "into place (default: from settings).", "dir");
+    QCommandLineOption archOpt("archives", "Also convert discs inside .zip/.7z/.rar archives, unpacking each "
+                                           "one just before its job.");
+    QCommandLineOption unpackOpt("unpack", "Scratch folder for unpacked discs (default: from settings).", "dir");
+    QCommandLineOption workerOpt("worker", "Also run jobs on this opendhc-worker (host:port or socket path); "
+                                           "repeatable (default: from settings).", "address");
+    QCommandLineOption workerTokenOpt("worker-token", "Shared secret the workers were started with "
+                                                      "(default: $OPENDHC_WORKER_TOKEN, then settings).", "secret");
+    QCommandLineOption watchOpt("watch", "After the initial scan, keep watching source folders and queue each new "
+                                         "disc once all its files are in place. Runs until SIGINT/SIGTERM, then "
+                                         "lets queued jobs finish and writes the reports.");
+    QCommandLineOption settleOpt("settle", "With --watch, how long a disc's files must stay unchanged before it is "
+                                           "queued, in ms (default 3000).", "ms", "3000");
+    QCommandLineOption hashOpt("hash", "Record CRC32/MD5/SHA1 of create inputs and extract outputs in the report.");
+    QCommandLineOption datOpt("dat", "Check hashed files against this Redump/No-Intro DAT; implies --hash "
+                                     "(default: from settings).", "file");
+    QCommandLineOption journalOpt("journal", "Record the batch in this journal. A batch recorded there that was cut "
+                                             "short is resumed first; inputs it already converted are skipped.", "file");
+    QCommandLineOption logOpt("log", "Also emit chdman output lines as log events.");
+    QCommandLineOption mdOpt("report-md", "Write the final Markdown report to file.", "file");
+    QCommandLineOption csvOpt("report-csv", "Write the final CSV report to file.", "file");
+    QCommandLineOption tuneOpt("tune", "Instead of converting, run codec/hunk trials on n inputs per media type "
+                                       "and save the best profiles to the settings.", "n");
+    QCommandLineOption tuneMbpsOpt("tune-min-mbps", "Slowest acceptable encode speed for --tune, in MiB/s (default 0).",
+                                   "mbps", "0");
+    cli.addOptions({ typeOpt, outOpt, concOpt, chdmanOpt, extraOpt, flatOpt, noRecOpt, noCdOpt, noDvdOpt,
+                     skipOpt, verifyOpt, delOpt, dedupOpt, linkOpt, stageOpt, archOpt, unpackOpt, workerOpt, workerTokenOpt, watchOpt, settleOpt, hashOpt, datOpt, journalOpt, logOpt, mdOpt, csvOpt, tuneOpt, tuneMbpsOpt });
+    cli.process(app);
+
+    JobType jobType{};
+    if (!parseJobType(cli.value(typeOpt), jobType)) {
+        QTextStream(stderr) << "Unknown job type: " << cli.value(typeOpt) << '\n';
+        return 2;
+    }
+    const QStringList sources = cli.positionalArguments();
+    if (sources.isEmpty()) cli.showHelp(2);
+
+    Settings settings;
+    ChdmanRunner runner;
+    BatchScanner scanner;
+    Report report;
+
+    runner.setChdmanPath(cli.isSet(chdmanOpt) ? cli.value(chdmanOpt) : settings.chdmanPath());
+    runner.setConcurrency(cli.isSet(concOpt) ? cli.value(concOpt).toInt() : settings.concurrency());
+    runner.setPerDeviceLimit(settings.perDeviceLimit());
+    runner.setQueuePolicy(settings.queuePolicy());
+    runner.setThreadBudget(settings.threadBudget());
+    runner.setBoostTail(settings.boostTail());
+    runner.setPrefetchDepth(settings.prefetchDepth());
+    runner.setPrefetchBudgetMiB(settings.prefetchBudgetMiB());
+    runner.setStagingDir(cli.isSet(stageOpt) ? QFileInfo(cli.value(stageOpt)).absoluteFilePath() : settings.stagingDir());
+    runner.setStagingBudgetMiB(settings.stagingBudgetMiB());
+    runner.setUnpackDir(cli.isSet(unpackOpt) ? QFileInfo(cli.value(unpackOpt)).absoluteFilePath() : settings.unpackDir());
+    runner.setUnpackBudgetMiB(settings.unpackBudgetMiB());
+    runner.setSpaceMarginMiB(settings.spaceMarginMiB());
+    const QString envToken = qEnvironmentVariable("OPENDHC_WORKER_TOKEN");
+    runner.setWorkerToken(cli.isSet(workerTokenOpt) ? cli.value(workerTokenOpt)
+                          : !envToken.isEmpty() ? envToken : settings.workerToken());
+    runner.setWorkers(cli.isSet(workerOpt) ? cli.values(workerOpt) : settings.workerList());
+    runner.setCodecProfile(MediaType::CD, settings.cdProfile());
+    runner.setCodecProfile(MediaType::DVD, settings.dvdProfile());
+    scanner.setCacheFile(settings.scanIndexFile());
+
+    if (cli.isSet(tuneOpt)) {
+        QStringList inputs;
+        for (const auto& src : sources) {
+            const QFileInfo fi(src);
+            if (fi.isDir()) inputs << scanner.findInputs(fi.absoluteFilePath(), !cli.isSet(noRecOpt),
+                                                         !cli.isSet(noCdOpt), !cli.isSet(noDvdOpt));
+            else if (fi.isFile()) inputs << fi.absoluteFilePath();
+        }
+        CodecTuner tuner;
+        tuner.setChdmanPath(runner.chdmanPath());
+        QObject::connect(&tuner,&CodecTuner::trialFinished,&app,[](const QVariantMap& r){
+            emitEvent("trial", QJsonObject::fromVariantMap(r));
+        });
+        int chosen = 0;
+        QObject::connect(&tuner,&CodecTuner::profileChosen,&app,[&](int media, const QString& args, const QVariantMap& r){
+            settings.setProfile(media, args);
+            ++chosen;
+            emitEvent("profile", QJsonObject::fromVariantMap(r));
+        });
+        QObject::connect(&tuner,&CodecTuner::finished,&app,[&](bool){
+            if (!chosen) QTextStream(stderr) << tuner.status() << '\n';
+            QCoreApplication::exit(chosen ? 0 : 1);
+        });
+        QMetaObject::invokeMethod(&app, [&]{
+            tuner.start(inputs, cli.value(tuneOpt).toInt(), cli.value(tuneMbpsOpt).toDouble());
+        }, Qt::QueuedConnection);
+        return app.exec();
+    }
+
+    const QString outRoot = QFileInfo(cli.value(outOpt)).absoluteFilePath();
+    const QStringList extra = cli.value(extraOpt).split(' ', Qt::SkipEmptyParts);
+    const bool preserve = !cli.isSet(flatOpt);
+    const bool delSrc = cli.isSet(delOpt);
+    const bool withLog = cli.isSet(logOpt);
+    const bool dedup = cli.isSet(dedupOpt) || cli.isSet(linkOpt);
+    const bool linkDups = cli.isSet(linkOpt);
+    const bool archives = cli.isSet(archOpt);
+    if (archives && !scanner.archivesSupported()) {
+        QTextStream(stderr) << "--archives: this build has no archive support (libarchive)\n";
+        return 2;
+    }
+    QHash<QString, QStringList> dupsOf;   // primary input -> identical inputs of the current scan
+
+    // Jobs keyed by id; kept for the report and source deletion
+    struct Runtime { Job j; qint64 t0=0; quint64 inB=0; };
+    QHash<QString, Runtime> jobs;
+    int queued = 0, finished = 0, pendingScans = 0;
+    int nextId = 0;
+    JobJournal journal;
+
+    HashVerifier verifier;
+    const QString datFile = cli.isSet(datOpt) ? cli.value(datOpt) : settings.datFile();
+    if (!datFile.isEmpty() && !verifier.loadDat(datFile)) {
+        QTextStream(stderr) << "Cannot load DAT " << datFile << ": " << verifier.lastError() << '\n';
+        return 2;
+    }
+    const bool hash = cli.isSet(hashOpt) || settings.hashInputs() || verifier.datEntries()>0;
+
+    WatchFolder watcher;
+    auto finishIfIdle = [&]{
+        if (pendingScans>0 || finished<queued || verifier.pending()>0 || watcher.watching()) return;
+        journal.reset();   // the batch is complete
+        if (cli.isSet(mdOpt)) report.saveMarkdown(cli.value(mdOpt));
+        if (cli.isSet(csvOpt)) report.saveCsv(cli.value(csvOpt));
+        auto slice = [](const Report::Breakdown& b){
+            return QJsonObject{{"total", b.total}, {"ok", b.ok}, {"inputBytes", qint64(b.inBytes)},
+                               {"outputBytes", qint64(b.outBytes)}, {"savedPct", b.savedPct()},
+                               {"p50Mbps", b.percentileMbps(50)}, {"p90Mbps", b.percentileMbps(90)}};
+        };
+        emitEvent("summary", {{"total", report.total()}, {"ok", report.ok()}, {"failed", report.failed()},
+                              {"savedPct", report.savedPct()}, {"datMatched", report.datMatched()},
+                              {"datFailed", report.datFailed()},
+                              {"cd", slice(report.byMedia(MediaType::CD))}, {"dvd", slice(report.byMedia(MediaType::DVD))}});
+        QCoreApplication::exit(report.failed()>0 || report.datFailed()>0 ? 1 : 0);
+    };
+
+    QSet<QString> seen;   // a disc found by both the scan and the watcher is queued once
+    auto queueInput = [&](const QString& input, const QString& sourceRoot){
+        if (seen.contains(input)) return;
+        seen.insert(input);
+        const auto media = input.endsWith(".iso", Qt::CaseInsensitive) ? MediaType::DVD : MediaType::CD;
+        Job j;
+        j.id = QString::number(nextId++);
+        j.type = jobType; j.media = media; j.inputPath = input;
+        j.outputPath = scanner.defaultOutputForInvokable(input, int(jobType), int(media), outRoot, preserve, sourceRoot);
+        j.extraArgs = extra; j.deleteSourceAfter = delSrc; j.preserveStructure = preserve;
+        for (const auto& d : dupsOf.take(input)) {
+            if (linkDups && !j.outputPath.isEmpty())
+                j.linkOutputs << scanner.defaultOutputForInvokable(d, int(jobType), int(media), outRoot, preserve, sourceRoot);
+        }
+        // Steps of the pipeline are jobs of their own: queued, finished and reported one by one
+        const auto steps = buildPipeline(j, cli.isSet(verifyOpt));
+        journal.added(steps);
+        for (const auto& step : steps) {
+            jobs.insert(step.id, {step});
+            ++queued;
+            emitEvent("queued", {{"id", step.id}, {"input", step.inputPath}, {"output", step.outputPath},
+                                 {"pipeline", step.pipeline}});
+            runner.enqueue(step.id, step);
+        }
+    };
+
+    QObject::connect(&runner,&ChdmanRunner::jobStarted,&journal,&JobJournal::started);
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&journal,&JobJournal::finished);
+    QObject::connect(&runner,&ChdmanRunner::jobRequeued,&journal,&JobJournal::requeued);
+    QObject::connect(&runner,&ChdmanRunner::jobUnpacking,&journal,&JobJournal::unpacking);
+    QObject::connect(&runner,&ChdmanRunner::jobStarted,&app,[&](const QString& id){
+        auto it = jobs.find(id); if (it==jobs.end()) return;
+        it->t0 = QDateTime::currentMSecsSinceEpoch();
+        it->inB = runner.inputBytes(id);
+        emitEvent("started", {{"id", id}, {"input", it->j.inputPath}});
+        if (hash && it->j.type==JobType::Create && !Archive::isMember(it->j.inputPath))
+            verifier.hashJob(id, Hasher::discFiles(it->j.inputPath));
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobProgress,&app,[&](const QString& id, int p){
+        emitEvent("progress", {{"id", id}, {"percent", p}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobRatio,&app,[&](const QString& id, double r){
+        emitEvent("ratio", {{"id", id}, {"ratio", r}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobStats,&app,[&](const QString& id, const JobStats& s){
+        auto it = jobs.find(id); if (it==jobs.end()) return;
+        it->j.stats = s;
+        emitEvent("stats", {{"id", id}, {"mbps", s.mbps}, {"etaSec", s.etaSec}, {"userSec", s.userSec},
+                            {"sysSec", s.sysSec}, {"maxRssKb", qint64(s.maxRssKb)},
+                            {"readBytes", qint64(s.readBytes)}, {"writeBytes", qint64(s.writeBytes)}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobLog,&app,[&](const QString& id, const QString& line){
+        if (withLog) emitEvent("log", {{"id", id}, {"line", line}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobInfo,&app,[&](const QString& id, const QVariantMap& info){
+        auto it = jobs.find(id); if (it==jobs.end()) return;
+        it->j.info = info;
+        emitEvent("info", {{"id", id}, {"info", QJsonObject::fromVariantMap(info)}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&app,[&](const QString& id, bool ok){
+        auto it = jobs.find(id); if (it==jobs.end()) return;
+        const Job& j = it->j;
+        const quint64 outB = (j.type==JobType::Create || j.type==JobType::Extract) ? QFileInfo(j.outputPath).size() : 0;
+        const qint64 msec = it->t0 ? QDateTime::currentMSecsSinceEpoch()-it->t0 : 0;
+        report.add({ id, ok, it->inB, outB, msec, j.inputPath, j.outputPath, ok ? "Done" : "Failed", QString(), j.info, j.stats, j.type, j.media });
+        emitEvent("finished", {{"id", id}, {"ok", ok}, {"inputBytes", qint64(it->inB)},
+                               {"outputBytes", qint64(outB)}, {"msec", msec}});
+        for (const auto& dup : j.linkOutputs) {
+            if (!ok) break;
+            emitEvent("linked", {{"id", id}, {"output", dup}, {"target", j.outputPath},
+                                 {"ok", Dedup::linkOutput(j.outputPath, dup)}});
+        }
+        if (ok && hash && j.type==JobType::Extract) verifier.hashJob(id, Hasher::discFiles(j.outputPath));
+        jobs.erase(it);
+        ++finished;
+        finishIfIdle();
+    });
+    QObject::connect(&verifier,&HashVerifier::jobHashed,&app,[&](const QString& id, const QList<Hasher::FileHash>& hashes){
+        static const char* const kMatch[] = { "", "match", "unknown", "mismatch" };
+        report.attachHashes(id, hashes);
+        QJsonArray files;
+        for (const auto& h : hashes) {
+            QJsonObject f{{"file", h.file}, {"size", qint64(h.size)}, {"ok", h.ok}};
+            if (h.ok) {
+                f.insert("crc32", h.crcHex());
+                f.insert("md5", QString::fromLatin1(h.md5.toHex()));
+                f.insert("sha1", QString::fromLatin1(h.sha1.toHex()));
+            } else {
+                f.insert("error", h.error);
+            }
+            if (h.match!=Hasher::FileHash::NotChecked) { f.insert("dat", kMatch[h.match]); f.insert("game", h.game); }
+            files << f;
+        }
+        emitEvent("hashed", {{"id", id}, {"summary", Hasher::summary(hashes)}, {"files", files}});
+        finishIfIdle();
+    });
+
+    if (cli.isSet(journalOpt)) {
+        const QString file = QFileInfo(cli.value(journalOpt)).absoluteFilePath();
+        const auto resumed = journal.open(file, runner.stagingDir());
+        if (!journal.isOpen()) {
+            QTextStream(stderr) << "Cannot open journal " << file << '\n';
+            return 2;
+        }
+        seen.unite(resumed.doneInputs);
+        journal.added(resumed.jobs);
+        for (const auto& id : resumed.finished)   // new ids mustn't take over recorded ones
+            nextId = std::max(nextId, id.section('-', 0, 0).toInt() + 1);
+        for (const auto& j : resumed.jobs) {
+            seen.insert(j.inputPath);
+            nextId = std::max(nextId, j.id.section('-', 0, 0).toInt() + 1);
+            jobs.insert(j.id, {j});
+            ++queued;
+            emitEvent("resumed", {{"id", j.id}, {"input", j.inputPath}, {"output", j.outputPath},
+                                  {"pipeline", j.pipeline}, {"interrupted", resumed.interrupted.contains(j.id)}});
+        }
+        for (const auto& j : resumed.jobs) runner.enqueue(j.id, j);
+        emitEvent("journal", {{"file", file}, {"resumed", int(resumed.jobs.size())}, {"finished", int(resumed.finished.size())}});
+    }
+
+    // Folders are scanned one after another; their inputs start converting
+    // while the walk is still running.
+    QStringList folders;
+    for (const auto& s : sources) {
+        const QFileInfo fi(s);
+        if (fi.isDir()) folders << fi.absoluteFilePath();
+        else if (fi.isFile() && archives && Archive::isArchive(s)) {
+            for (const auto& in : scanner.archiveInputs(fi.absoluteFilePath(), !cli.isSet(noCdOpt), !cli.isSet(noDvdOpt)))
+                queueInput(in, QString());
+        }
+        else if (fi.isFile()) queueInput(fi.absoluteFilePath(), QString());
+        else QTextStream(stderr) << "Skipping missing source: " << s << '\n';
+    }
+    pendingScans = folders.size();
+    if (cli.isSet(watchOpt) && !folders.isEmpty()) {
+        // Watch before scanning, so nothing dropped in meanwhile is missed
+        watcher.setSettleMs(cli.value(settleOpt).toInt());
+        QObject::connect(&watcher,&WatchFolder::error,&app,[](const QString& msg){
+            QTextStream(stderr) << msg << '\n';
+        });
+        QObject::connect(&watcher,&WatchFolder::inputsReady,&app,[&](const QStringList& inputs, const QString& root){
+            for (const auto& in : inputs) {
+                emitEvent("detected", {{"input", in}});
+                queueInput(in, root);
+            }
+        });
+        if (watcher.start(folders, !cli.isSet(noRecOpt), !cli.isSet(noCdOpt), !cli.isSet(noDvdOpt), archives))
+            emitEvent("watching", {{"sources", QJsonArray::fromStringList(folders)}});
+        // Interrupting stops the watch; the batch then ends like any other
+        if (watcher.watching() && ::pipe2(stopPipe, O_CLOEXEC)==0) {
+            auto stop = new QSocketNotifier(stopPipe[0], QSocketNotifier::Read, &app);
+            QObject::connect(stop, &QSocketNotifier::activated, &app, [&, stop]{
+                char c;
+                (void)!::read(stopPipe[0], &c, 1);
+                stop->setEnabled(false);
+                emitEvent("stopping", {});
+                watcher.stop();
+                runner.setInputsPending(pendingScans>0);
+                finishIfIdle();
+            });
+            std::signal(SIGINT, onStopSignal);
+            std::signal(SIGTERM, onStopSignal);
+        }
+    }
+    runner.setInputsPending(pendingScans>0 || watcher.watching());
+    QString currentRoot;
+    auto scanNext = [&]{
+        currentRoot = folders.takeFirst();
+        scanner.startScan(currentRoot, !cli.isSet(noRecOpt), !cli.isSet(noCdOpt), !cli.isSet(noDvdOpt),
+                          outRoot, int(jobType), preserve, cli.isSet(skipOpt), dedup, archives);
+    };
+    QObject::connect(&scanner,&BatchScanner::duplicatesFound,&app,[&](const QString& primary, const QStringList& dups){
+        dupsOf.insert(primary, dups);
+        for (const auto& d : dups) emitEvent("duplicate", {{"input", d}, {"of", primary}});
+    });
+    QObject::connect(&scanner,&BatchScanner::dedupFinished,&app,[&](int inputs, qint64 bytes, qint64 msec){
+        emitEvent("deduped", {{"source", currentRoot}, {"inputs", inputs}, {"bytesHashed", bytes}, {"msec", msec}});
+    });
+    QObject::connect(&scanner,&BatchScanner::inputsFound,&app,[&](const QStringList& inputs){
+        for (const auto& in : inputs) queueInput(in, currentRoot);
+    });
+    QObject::connect(&scanner,&BatchScanner::scanFinished,&app,[&](bool){
+        --pendingScans;
+        runner.setInputsPending(pendingScans>0 || watcher.watching());
+        emitEvent("scanned", {{"source", currentRoot}});
+        if (!folders.isEmpty()) scanNext();
+        else finishIfIdle();
+    });
+    if (!folders.isEmpty()) scanNext();
+
+    QMetaObject::invokeMethod(&app, finishIfIdle, Qt::QueuedConnection);   // nothing to do at all
+    return app.exec();
+}
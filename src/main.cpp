@@ -3,11 +3,19 @@
 #include <QQmlContext>
 #include <QFile>
 #include "app/JobModel.hpp"
+#include "app/JobFilterModel.hpp"
+#include "app/JobJournal.hpp"
 #include "app/ChdmanRunner.hpp"
 #include "app/Settings.hpp"
 #include "app/BatchScanner.hpp"
 #include "app/Report.hpp"
-#include "app/SizeUtil.hpp"
+#include "app/LogStore.hpp"
+#include "app/CodecTuner.hpp"
+#include "app/Dedup.hpp"
+#include "app/WatchFolder.hpp"
+#include "app/HashVerifier.hpp"
+#include "app/Archive.hpp"
+#include <QStandardPaths>
 
 int main(int argc, char *argv[]) {
     QGuiApplication app(argc, argv);
@@ -15,61 +23,190 @@ int main(int argc, char *argv[]) {
     QGuiApplication::setApplicationName("OpenDHC");
 
     JobModel jobs;
+    JobFilterModel jobView(&jobs);
     ChdmanRunner runner;
     Settings settings;
     BatchScanner scanner;
+    WatchFolder watcher;
+    HashVerifier verifier;
     Report report;
+    LogStore logs;
+    CodecTuner tuner;
+    JobJournal journal;
+
+    logs.setSpillDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/logs");
+    jobs.setLogStore(&logs);
 
     runner.setChdmanPath(settings.chdmanPath());
     runner.setConcurrency(settings.concurrency());
+    runner.setPerDeviceLimit(settings.perDeviceLimit());
+    runner.setQueuePolicy(settings.queuePolicy());
+    runner.setThreadBudget(settings.threadBudget());
+    runner.setBoostTail(settings.boostTail());
+    runner.setPrefetchDepth(settings.prefetchDepth());
+    runner.setPrefetchBudgetMiB(settings.prefetchBudgetMiB());
+    runner.setStagingDir(settings.stagingDir());
+    runner.setStagingBudgetMiB(settings.stagingBudgetMiB());
+    runner.setUnpackDir(settings.unpackDir());
+    runner.setUnpackBudgetMiB(settings.unpackBudgetMiB());
+    runner.setSpaceMarginMiB(settings.spaceMarginMiB());
+    runner.setWorkerToken(settings.workerToken());
+    runner.setWorkers(settings.workerList());
+    runner.setCodecProfile(MediaType::CD, settings.cdProfile());
+    runner.setCodecProfile(MediaType::DVD, settings.dvdProfile());
+    tuner.setChdmanPath(settings.chdmanPath());
+    scanner.setCacheFile(settings.scanIndexFile());
+    QString loadedDat = settings.datFile();
+    if (!loadedDat.isEmpty()) verifier.loadDat(loadedDat);
     QObject::connect(&settings,&Settings::changed,[&]{
+        if (settings.datFile()!=loadedDat) {
+            loadedDat = settings.datFile();
+            if (loadedDat.isEmpty()) verifier.clearDat(); else verifier.loadDat(loadedDat);
+        }
         runner.setChdmanPath(settings.chdmanPath());
         runner.setConcurrency(settings.concurrency());
+        runner.setPerDeviceLimit(settings.perDeviceLimit());
+        runner.setQueuePolicy(settings.queuePolicy());
+        runner.setThreadBudget(settings.threadBudget());
+        runner.setBoostTail(settings.boostTail());
+        runner.setPrefetchDepth(settings.prefetchDepth());
+        runner.setPrefetchBudgetMiB(settings.prefetchBudgetMiB());
+        runner.setStagingDir(settings.stagingDir());
+        runner.setStagingBudgetMiB(settings.stagingBudgetMiB());
+        runner.setUnpackDir(settings.unpackDir());
+        runner.setUnpackBudgetMiB(settings.unpackBudgetMiB());
+        runner.setSpaceMarginMiB(settings.spaceMarginMiB());
+        runner.setWorkerToken(settings.workerToken());
+        runner.setWorkers(settings.workerList());
+        runner.setCodecProfile(MediaType::CD, settings.cdProfile());
+        runner.setCodecProfile(MediaType::DVD, settings.dvdProfile());
+        tuner.setChdmanPath(settings.chdmanPath());
     });
+    // The tuner's pick becomes the default for new create jobs
+    QObject::connect(&tuner,&CodecTuner::profileChosen,&settings,&Settings::setProfile);
 
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty("jobModel", &jobs);
+    engine.rootContext()->setContextProperty("jobFilter", &jobView);
     engine.rootContext()->setContextProperty("runner", &runner);
     engine.rootContext()->setContextProperty("settings", &settings);
     engine.rootContext()->setContextProperty("scanner", &scanner);
+    engine.rootContext()->setContextProperty("watcher", &watcher);
+    engine.rootContext()->setContextProperty("verifier", &verifier);
     engine.rootContext()->setContextProperty("report", &report);
+    engine.rootContext()->setContextProperty("logs", &logs);
+    engine.rootContext()->setContextProperty("tuner", &tuner);
+    engine.rootContext()->setContextProperty("journal", &journal);
 
     const QUrl url(u"qrc:/ui/qml/Main.qml"_qs);
     QObject::connect(&engine, &QQmlApplicationEngine::objectCreated, &app,
-        url {
+        [url](QObject* obj, const QUrl& objUrl) {
             if (!obj && url == objUrl) QCoreApplication::exit(-1);
         }, Qt::QueuedConnection);
     engine.load(url);
 
+    // While a scan or the watcher may still add jobs, the batch has no tail yet
+    auto inputsPending = [&]{ runner.setInputsPending(scanner.scanning() || watcher.watching()); };
+    QObject::connect(&scanner,&BatchScanner::scanningChanged,&runner,inputsPending);
+    QObject::connect(&watcher,&WatchFolder::watchingChanged,&runner,inputsPending);
+    // Jobs added from QML (single or as pipelines) go straight to the runner
+    QObject::connect(&jobs,&JobModel::jobsAdded,&runner,[&](const QList<Job>& added){
+        for (const auto& j : added) runner.enqueue(j.id, j);
+    });
+    // Every job and state change goes to the journal, which resumes the batch on the next launch
+    QObject::connect(&jobs,&JobModel::jobsAdded,&journal,&JobJournal::added);
+    QObject::connect(&runner,&ChdmanRunner::jobStarted,&journal,&JobJournal::started);
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&journal,&JobJournal::finished);
+    QObject::connect(&runner,&ChdmanRunner::jobRequeued,&journal,&JobJournal::requeued);
+    QObject::connect(&runner,&ChdmanRunner::jobUnpacking,&journal,&JobJournal::unpacking);
+    // A job removed from the list doesn't run, now or after a restart
+    QObject::connect(&jobs,&JobModel::jobRemoved,&runner,&ChdmanRunner::cancel);
+    QObject::connect(&jobs,&JobModel::jobRemoved,&journal,&JobJournal::removed);
+    QObject::connect(&runner,&ChdmanRunner::jobRequeued,&jobs,[&](const QString& id){
+        jobs.updateJob(id,[](Job& j){ j.status="Queued"; j.progress=0; j.ratio=-1; },
+                       {JobModel::StatusRole, JobModel::ProgressRole, JobModel::RatioRole});
+    });
+
+    // DAT verification: inputs are hashed while they convert, extracted outputs after
+    auto hashWanted = [&]{ return settings.hashInputs() || verifier.datEntries()>0; };
+    QObject::connect(&verifier,&HashVerifier::jobHashed,&jobs,[&](const QString& id, const QList<Hasher::FileHash>& hashes){
+        report.attachHashes(id, hashes);
+        logs.append(id, Hasher::summary(hashes));
+        if (jobs.indexById(id)>=0) jobs.updateJob(id, nullptr, {JobModel::LogRole});
+    });
+
     // Track job runtime and sizes for final report
     struct Runtime { qint64 t0=0; quint64 inB=0; };
     QHash<QString, Runtime> rt;
 
-    QObject::connect(&runner,&ChdmanRunner::jobStarted,&jobs,&{
-        jobs.updateJob(id,{ j.status="Running"; j.started=QDateTime::currentDateTime(); });
+    QObject::connect(&runner,&ChdmanRunner::jobStarted,&jobs,[&](const QString& id){
+        if (jobs.indexById(id)<0) return;
+        jobs.updateJob(id,[](Job& j){ j.status="Running"; j.started=QDateTime::currentDateTime(); },
+                       {JobModel::StatusRole});
         auto &j = jobs.jobRefById(id);
-        rt[id] = { QDateTime::currentMSecsSinceEpoch(), SizeUtil::estimateInputBytes(j) };
+        rt[id] = { QDateTime::currentMSecsSinceEpoch(), runner.inputBytes(id) };
+        // Hashed alongside chdman's own reads of the same files
+        if (hashWanted() && j.type==JobType::Create && !Archive::isMember(j.inputPath))
+            verifier.hashJob(id, Hasher::discFiles(j.inputPath));
     });
 
-    QObject::connect(&runner,&ChdmanRunner::jobProgress,&jobs,&{
-        jobs.updateJob(id,[&](Job& jess=p; });
+    QObject::connect(&runner,&ChdmanRunner::jobProgress,&jobs,[&](const QString& id, int p){
+        jobs.updateJob(id,[p](Job& j){ j.progress=p; }, {JobModel::ProgressRole});
     });
 
-    QObject::connect(&runner,&ChdmanRunner::jobLog,&jobs,&{
-        jobs.updateJob(id,&{ j.log += line + '\n'; });
+    QObject::connect(&runner,&ChdmanRunner::jobRatio,&jobs,[&](const QString& id, double r){
+        jobs.updateJob(id,[r](Job& j){ j.ratio=r; }, {JobModel::RatioRole});
     });
 
-    QObject::connect(&runner,&ChdmanRunner::jobFinished,&jobs,&{
-        auto &j = jobs.jobRefById(id);
-        j.progress=100; j.status = ok ? "Done" : "Failed"; j.ended=QDateTime::currentDateTime();
+    QObject::connect(&runner,&ChdmanRunner::jobStats,&jobs,[&](const QString& id, const JobStats& s){
+        jobs.updateJob(id,[&](Job& j){ j.stats = s; }, {JobModel::MbpsRole, JobModel::EtaRole});
+    });
+
+    QObject::connect(&runner,&ChdmanRunner::jobLog,&jobs,[&](const QString& id, const QString& line){
+        logs.append(id, line);
+        jobs.updateJob(id, nullptr, {JobModel::LogRole});
+    });
+
+    QObject::connect(&report,&Report::logsDropped,&logs,[&](const QStringList& ids){
+        for (const auto& id : ids) logs.removeSpill(id);
+    });
+
+    QObject::connect(&runner,&ChdmanRunner::jobInfo,&jobs,[&](const QString& id, const QVariantMap& info){
+        jobs.updateJob(id,[&](Job& j){ j.info = info; }, {JobModel::InfoRole});
+    });
+
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&jobs,[&](const QString& id, bool ok){
+        if (jobs.indexById(id)<0) { rt.remove(id); logs.finish(id); logs.release(id); return; }
+        jobs.updateJob(id,[ok](Job& j){
+            j.progress=100; j.status = ok ? "Done" : "Failed"; j.ended=QDateTime::currentDateTime();
+        }, {JobModel::ProgressRole, JobModel::StatusRole});
+        const auto &j = jobs.jobRefById(id);
         quint64 outB = (j.type==JobType::Create || j.type==JobType::Extract) ? QFileInfo(j.outputPath).size() : 0;
         auto it = rt.find(id);
         const qint64 msec = (it!=rt.end()) ? (QDateTime::currentMSecsSinceEpoch()-it->t0) : 0;
         const quint64 inB  = (it!=rt.end()) ? it->inB : 0;
-        report.add({ id, ok, inB, outB, msec, j.inputPath, j.outputPath, j.status, j.log });
-        rt.erase(id);
-        if (ok && j.deleteSourceAfter) QFile::remove(j.inputPath);
+        logs.finish(id);
+        report.add({ id, ok, inB, outB, msec, j.inputPath, j.outputPath, j.status, logs.spillPath(id), j.info, j.stats, j.type, j.media });
+        rt.remove(id);
+        if (ok && hashWanted() && j.type==JobType::Extract) verifier.hashJob(id, Hasher::discFiles(j.outputPath));
+        for (const auto& dup : j.linkOutputs) {
+            if (!ok) break;
+            logs.append(id, (Dedup::linkOutput(j.outputPath, dup) ? "Linked duplicate: " : "Could not link duplicate: ") + dup);
+        }
+    });
+
+    // An interrupted batch is offered to the user; its unfinished jobs go back
+    // to the runner only if they resume it
+    QObject::connect(&journal,&JobJournal::resumed,&app,[&](const JobJournal::Recovery& rec){
+        jobs.addJobs(rec.jobs);
+        for (const auto& id : rec.interrupted) {
+            logs.append(id, "Interrupted by the last session; partial output removed, queued again");
+            jobs.updateJob(id, nullptr, {JobModel::LogRole});
+        }
     });
+    const auto recovered = journal.open(settings.journalFile(), runner.stagingDir());
+    if (recovered.jobs.isEmpty()) journal.reset();
+    else journal.offer(recovered);
 
     return app.exec();
 }
@@ -0,0 +1,204 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QHostInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include "app/ChdmanRunner.hpp"
+#include "app/Settings.hpp"
+#include "app/WorkerProtocol.hpp"
+#include <functional>
+#include <memory>
+
+// Why a job sent to us is refused, or empty. Workers run single chdman
+// steps; deleting sources and sequencing steps stay with the coordinator.
+static QString refusal(const Job& j) {
+    if (j.type==JobType::DeleteSource) return "source deletion is not run on workers";
+    if (!j.dependsOn.isEmpty() || !j.pipeline.isEmpty() || !j.linkOutputs.isEmpty())
+        return "pipeline steps are not run on workers";
+    QString bad;
+    if (!WorkerProtocol::allowedArgs(j.extraArgs, &bad)) return "chdman option not allowed on workers: " + bad;
+    return QString();
+}
+
+// Compares without an early exit, so timing doesn't tell how much matched
+static bool sameToken(const QByteArray& a, const QByteArray& b) {
+    if (a.size()!=b.size()) return false;
+    char diff = 0;
+    for (qsizetype i=0; i<a.size(); ++i) diff |= char(a[i] ^ b[i]);
+    return diff==0;
+}
+
+// Runs chdman jobs for remote coordinators (see WorkerProtocol.hpp). Jobs go
+// through a local ChdmanRunner, so scheduling, thread budgets, staging and
+// prefetching behave as on the coordinator itself.
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("OpenDHC");
+    QCoreApplication::setApplicationName("OpenDHC");
+
+    QCommandLineParser cli;
+    cli.setApplicationDescription("OpenDHC worker: runs chdman jobs sent by OpenDHC or opendhc-cli.");
+    cli.addHelpOption();
+    QCommandLineOption listenOpt("listen", "TCP address to listen on (default 127.0.0.1:7411). Any other than "
+                                           "loopback needs --token.", "host:port",
+                                 "127.0.0.1:" + QString::number(WorkerProtocol::kDefaultPort));
+    QCommandLineOption socketOpt("socket", "Listen on this Unix socket instead of TCP.", "path");
+    QCommandLineOption concOpt({"j","concurrency"}, "Concurrent chdman processes (default: from settings).", "n");
+    QCommandLineOption chdmanOpt("chdman", "Path to chdman (default: from settings, then PATH).", "path");
+    QCommandLineOption nameOpt("name", "Name reported to coordinators (default: host name).", "name");
+    QCommandLineOption tokenOpt("token", "Shared secret coordinators must present (default: "
+                                         "$OPENDHC_WORKER_TOKEN).", "secret");
+    cli.addOptions({ listenOpt, socketOpt, concOpt, chdmanOpt, nameOpt, tokenOpt });
+    cli.process(app);
+    const QByteArray token = cli.isSet(tokenOpt) ? cli.value(tokenOpt).toUtf8() : qgetenv("OPENDHC_WORKER_TOKEN");
+
+    Settings settings;
+    ChdmanRunner runner;
+    runner.setChdmanPath(cli.isSet(chdmanOpt) ? cli.value(chdmanOpt) : settings.chdmanPath());
+    runner.setConcurrency(cli.isSet(concOpt) ? cli.value(concOpt).toInt() : settings.concurrency());
+    runner.setPerDeviceLimit(settings.perDeviceLimit());
+    runner.setThreadBudget(settings.threadBudget());
+    runner.setBoostTail(settings.boostTail());
+    runner.setPrefetchDepth(settings.prefetchDepth());
+    runner.setPrefetchBudgetMiB(settings.prefetchBudgetMiB());
+    runner.setStagingDir(settings.stagingDir());
+    runner.setStagingBudgetMiB(settings.stagingBudgetMiB());
+    const QString name = cli.isSet(nameOpt) ? cli.value(nameOpt) : QHostInfo::localHostName();
+
+    // Job ids are only unique per coordinator, so each is prefixed with its
+    // connection's serial inside our runner.
+    struct Route { QIODevice* io; QString id; };
+    QHash<QString, Route> routes;
+    quint64 serial = 0;
+    auto send = [&](const QString& key, QJsonObject msg){
+        const auto it = routes.constFind(key);
+        if (it==routes.constEnd()) return;
+        msg.insert("id", it->id);
+        it->io->write(WorkerProtocol::encode(msg));
+    };
+
+    // Nothing but the coordinator's hello is taken before it proved the token;
+    // a longer line than a hello needs ends the connection. A coordinator
+    // silent for as long as it takes it to give up on us is hung up on, which
+    // cancels its jobs: they have been queued again elsewhere by then.
+    auto accept = [&](QIODevice* io, const std::function<void(bool now)>& close){
+        const QString prefix = QString::number(++serial) + '/';
+        auto trusted = std::make_shared<bool>(false);
+        auto silence = new QTimer(io);
+        silence->setSingleShot(true);
+        silence->setInterval(WorkerProtocol::kSilenceMs);
+        QObject::connect(silence, &QTimer::timeout, io, [close]{ close(true); });   // nothing would flush
+        silence->start();
+        QObject::connect(io, &QIODevice::readyRead, &app, [&, io, close, prefix, trusted, silence]{
+            bool tooLong = false;
+            const auto msgs = WorkerProtocol::readAll(io, *trusted ? WorkerProtocol::kMaxLine
+                                                                   : WorkerProtocol::kMaxHelloLine, tooLong);
+            if (tooLong) { close(true); return; }
+            for (const auto& msg : msgs) {
+                silence->start();
+                const QString op = msg.value("op").toString();
+                if (!*trusted) {
+                    if (op!="hello" || msg.value("version").toInt()!=WorkerProtocol::kVersion
+                        || !sameToken(msg.value("token").toString().toUtf8(), token)) {
+                        io->write(WorkerProtocol::encode({{"ev", "denied"}}));
+                        close(false);
+                        return;
+                    }
+                    *trusted = true;
+                    io->write(WorkerProtocol::encode({{"ev", "hello"}, {"version", WorkerProtocol::kVersion},
+                                                      {"name", name}, {"slots", runner.concurrency()}}));
+                } else if (op=="run") {
+                    Job j = jobFromJson(msg.value("job").toObject());
+                    if (const QString why = refusal(j); !why.isEmpty()) {
+                        io->write(WorkerProtocol::encode({{"ev", "log"}, {"id", j.id}, {"line", "Refused: " + why}}));
+                        io->write(WorkerProtocol::encode({{"ev", "finished"}, {"id", j.id}, {"ok", false}}));
+                        continue;
+                    }
+                    const QString key = prefix + j.id;
+                    routes.insert(key, { io, j.id });
+                    j.id = key;
+                    runner.enqueue(key, j);
+                } else if (op=="ping") {
+                    io->write(WorkerProtocol::encode({{"ev", "pong"}}));
+                } else if (op=="cancel") {
+                    runner.cancel(prefix + msg.value("id").toString());
+                }
+            }
+        });
+        // Nobody is left to report to: drop that coordinator's jobs
+        QObject::connect(io, &QObject::destroyed, &app, [&, io]{
+            QStringList mine;
+            for (auto it = routes.cbegin(); it!=routes.cend(); ++it) if (it->io==io) mine << it.key();
+            for (const auto& key : mine) { routes.remove(key); runner.cancel(key); }
+        });
+    };
+
+    QObject::connect(&runner,&ChdmanRunner::jobStarted,&app,[&](const QString& id){
+        send(id, {{"ev", "started"}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobProgress,&app,[&](const QString& id, int p){
+        send(id, {{"ev", "progress"}, {"percent", p}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobRatio,&app,[&](const QString& id, double r){
+        send(id, {{"ev", "ratio"}, {"ratio", r}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobLog,&app,[&](const QString& id, const QString& line){
+        send(id, {{"ev", "log"}, {"line", line}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobInfo,&app,[&](const QString& id, const QVariantMap& info){
+        send(id, {{"ev", "info"}, {"info", QJsonObject::fromVariantMap(info)}});
+    });
+    // The last stats before jobFinished() are the final ones; they ride along with it
+    QHash<QString, JobStats> lastStats;
+    QObject::connect(&runner,&ChdmanRunner::jobStats,&app,[&](const QString& id, const JobStats& s){
+        lastStats.insert(id, s);
+        send(id, {{"ev", "stats"}, {"stats", statsToJson(s)}});
+    });
+    QObject::connect(&runner,&ChdmanRunner::jobFinished,&app,[&](const QString& id, bool ok){
+        send(id, {{"ev", "finished"}, {"ok", ok}, {"stats", statsToJson(lastStats.take(id))}});
+        routes.remove(id);
+    });
+
+    QTcpServer tcp;
+    QLocalServer local;
+    if (cli.isSet(socketOpt)) {
+        QLocalServer::removeServer(cli.value(socketOpt));   // stale socket from an earlier run
+        if (!local.listen(cli.value(socketOpt))) {
+            QTextStream(stderr) << "Cannot listen on " << cli.value(socketOpt) << ": " << local.errorString() << '\n';
+            return 1;
+        }
+        QObject::connect(&local, &QLocalServer::newConnection, &app, [&]{
+            while (QLocalSocket* s = local.nextPendingConnection()) {
+                QObject::connect(s, &QLocalSocket::disconnected, s, &QObject::deleteLater);
+                accept(s, [s](bool now){ now ? s->abort() : s->disconnectFromServer(); });
+            }
+        });
+    } else {
+        QString host; quint16 port;
+        WorkerProtocol::splitHostPort(cli.value(listenOpt), host, port);
+        const QHostAddress addr = host=="localhost" ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(host);
+        if (!addr.isLoopback() && token.isEmpty()) {
+            QTextStream(stderr) << "Listening on " << cli.value(listenOpt) << " needs --token" << '\n';
+            return 1;
+        }
+        if (!tcp.listen(addr, port)) {
+            QTextStream(stderr) << "Cannot listen on " << cli.value(listenOpt) << ": " << tcp.errorString() << '\n';
+            return 1;
+        }
+        QObject::connect(&tcp, &QTcpServer::newConnection, &app, [&]{
+            while (QTcpSocket* s = tcp.nextPendingConnection()) {
+                s->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                s->setSocketOption(QAbstractSocket::KeepAliveOption, 1);   // coordinators that vanish
+                QObject::connect(s, &QTcpSocket::disconnected, s, &QObject::deleteLater);
+                accept(s, [s](bool now){ now ? s->abort() : s->disconnectFromHost(); });
+            }
+        });
+    }
+    QTextStream(stdout) << "opendhc-worker " << name << ": " << runner.concurrency() << " slots, listening on "
+                        << (cli.isSet(socketOpt) ? cli.value(socketOpt) : cli.value(listenOpt)) << Qt::endl;
+    return app.exec();
+}
@@ -10,6 +10,9 @@ ApplicationWindow {
     width: 1100; height: 700
     title: "OpenDHC"
 
+    property var tuneInputs: null   // set while the scanner collects inputs for the tuner
+    property var watchedQueued: ({}) // inputs queued while watching: a disc found by both the scan and the watcher is queued once
+
     // Material style
     Material.theme: Material.Dark
     Material.accent: Material.Blue
@@ -19,6 +22,18 @@ ApplicationWindow {
     //
     Native.MessageDialog { id: infoDialog }
 
+    Native.MessageDialog {
+        id: resumeDialog
+        text: "The last session left " + journal.resumableJobs + " unfinished jobs. Resume them?"
+        buttons: Native.MessageDialog.Yes | Native.MessageDialog.No
+        onYesClicked: journal.resume()
+        onNoClicked: journal.discard()
+    }
+    Connections {
+        target: journal
+        function onResumableChanged() { if (journal.resumableJobs > 0) resumeDialog.open() }
+    }
+
     Native.FileDialog {
         id: chdPicker
         title: "Select chdman"
@@ -38,6 +53,35 @@ ApplicationWindow {
         }
     }
 
+    Native.FolderDialog {
+        id: stagingFolder
+        title: "Select staging folder"
+        onAccepted: {
+            stageDir.text = folder
+            settings.stagingDir = folder
+        }
+    }
+
+    Native.FileDialog {
+        id: datPicker
+        title: "Select DAT file"
+        fileMode: Native.FileDialog.OpenFile
+        nameFilters: ["DAT files (*.dat *.xml)", "All files (*)"]
+        onAccepted: {
+            datFile.text = file
+            settings.datFile = file
+        }
+    }
+
+    Native.FolderDialog {
+        id: unpackFolder
+        title: "Select unpack folder"
+        onAccepted: {
+            unpackDir.text = folder
+            settings.unpackDir = folder
+        }
+    }
+
     Native.FileDialog {
         id: inputsPicker
         title: "Select input(s)"
@@ -68,6 +112,19 @@ ApplicationWindow {
         }
     }
 
+    Native.FileDialog {
+        id: saveMdDialog
+        title: "Save Markdown"
+        fileMode: Native.FileDialog.SaveFile
+        nameFilters: [ "Markdown (*.md)" ]
+        onAccepted: {
+            if (!report.saveMarkdown(file)) {
+                infoDialog.text = "Could not write Markdown"
+                infoDialog.open()
+            }
+        }
+    }
+
     header: ToolBar {
         RowLayout { anchors.fill: parent; spacing: 12
             Label { text: "OpenDHC"; font.pixelSize: 18; Layout.margins: 8 }
@@ -122,6 +179,189 @@ ApplicationWindow {
                 }
                 Label { text: Math.round(conc.value).toString() }
             }
+
+            RowLayout {
+                TextField {
+                    text: settings.workers
+                    placeholderText: "Remote workers, e.g. node1:7411 node2:7411"
+                    Layout.fillWidth: true
+                    onEditingFinished: settings.workers = text
+                }
+                TextField {
+                    text: settings.workerToken
+                    placeholderText: "Worker token"
+                    echoMode: TextInput.Password
+                    onEditingFinished: settings.workerToken = text
+                }
+                Label {
+                    visible: runner.workers.length > 0
+                    text: runner.remoteSlots + " remote slots"
+                }
+            }
+
+            RowLayout {
+                Label { text: "Per device" }
+                Slider {
+                    id: perDev; from: 0; to: 16; stepSize: 1
+                    value: settings.perDeviceLimit
+                    Layout.fillWidth: true
+                    onMoved: settings.perDeviceLimit = Math.round(value)
+                }
+                Label { text: Math.round(perDev.value)===0 ? "Auto" : Math.round(perDev.value).toString() }
+            }
+
+            RowLayout {
+                Label { text: "Queue order" }
+                ComboBox {
+                    model: ["FIFO", "Largest first", "Smallest first"]
+                    currentIndex: settings.queuePolicy
+                    Layout.fillWidth: true
+                    onActivated: settings.queuePolicy = currentIndex
+                }
+            }
+
+            RowLayout {
+                Label { text: "Thread budget" }
+                SpinBox {
+                    from: 0; to: 256; editable: true
+                    value: settings.threadBudget
+                    onValueModified: settings.threadBudget = value
+                    textFromValue: function(v) { return v===0 ? "Auto" : String(v) }
+                }
+                CheckBox {
+                    text: "Boost tail"
+                    checked: settings.boostTail
+                    onToggled: settings.boostTail = checked
+                }
+            }
+
+            RowLayout {
+                Label { text: "Prefetch" }
+                SpinBox {
+                    from: 0; to: 16; editable: true
+                    value: settings.prefetchDepth
+                    onValueModified: settings.prefetchDepth = value
+                    textFromValue: function(v) { return v===0 ? "Off" : v + " jobs" }
+                }
+                SpinBox {
+                    from: 0; to: 65536; stepSize: 256; editable: true
+                    enabled: settings.prefetchDepth > 0
+                    value: settings.prefetchBudgetMiB
+                    onValueModified: settings.prefetchBudgetMiB = value
+                    textFromValue: function(v) { return v + " MB" }
+                }
+            }
+
+            RowLayout {
+                TextField {
+                    id: stageDir
+                    text: settings.stagingDir
+                    placeholderText: "Local staging folder (empty = write in place)"
+                    Layout.fillWidth: true
+                    onEditingFinished: settings.stagingDir = text
+                }
+                Button { text: "Browse"; onClicked: stagingFolder.open() }
+            }
+            RowLayout {
+                Label { text: "Staging budget" }
+                SpinBox {
+                    from: 0; to: 1048576; stepSize: 1024; editable: true
+                    enabled: settings.stagingDir.length > 0
+                    value: settings.stagingBudgetMiB
+                    onValueModified: settings.stagingBudgetMiB = value
+                    textFromValue: function(v) { return v===0 ? "Free space" : v + " MB" }
+                }
+            }
+
+            RowLayout {
+                visible: scanner.archivesSupported
+                TextField {
+                    id: unpackDir
+                    text: settings.unpackDir
+                    placeholderText: "Folder for discs unpacked from archives (empty = temp)"
+                    Layout.fillWidth: true
+                    onEditingFinished: settings.unpackDir = text
+                }
+                Button { text: "Browse"; onClicked: unpackFolder.open() }
+            }
+            RowLayout {
+                visible: scanner.archivesSupported
+                Label { text: "Unpack budget" }
+                SpinBox {
+                    from: 0; to: 1048576; stepSize: 1024; editable: true
+                    value: settings.unpackBudgetMiB
+                    onValueModified: settings.unpackBudgetMiB = value
+                    textFromValue: function(v) { return v===0 ? "Free space" : v + " MB" }
+                }
+            }
+            RowLayout {
+                Label { text: "Keep free on output drives" }
+                SpinBox {
+                    from: 0; to: 1048576; stepSize: 256; editable: true
+                    value: settings.spaceMarginMiB
+                    onValueModified: settings.spaceMarginMiB = value
+                    textFromValue: function(v) { return v + " MB" }
+                }
+            }
+
+            Label { text: "Hashing & DAT verification"; font.bold: true }
+            RowLayout {
+                TextField {
+                    id: datFile
+                    text: settings.datFile
+                    placeholderText: "Redump/No-Intro DAT (optional)"
+                    Layout.fillWidth: true
+                    onEditingFinished: settings.datFile = text
+                }
+                Button { text: "Browse"; onClicked: datPicker.open() }
+            }
+            RowLayout {
+                CheckBox {
+                    text: "Hash inputs"
+                    checked: settings.hashInputs || verifier.datEntries > 0
+                    enabled: verifier.datEntries === 0
+                    onToggled: settings.hashInputs = checked
+                }
+                Label {
+                    visible: verifier.datEntries > 0
+                    text: verifier.datName + " • " + verifier.datEntries + " entries"
+                }
+            }
+
+            Label { text: "Codec profiles (create jobs)"; font.bold: true }
+            TextField {
+                text: settings.cdProfile
+                placeholderText: "CD, e.g. -c cdzl,cdfl -hs 9792"
+                Layout.fillWidth: true
+                onEditingFinished: settings.cdProfile = text
+            }
+            TextField {
+                text: settings.dvdProfile
+                placeholderText: "DVD, e.g. -c zlib,huff -hs 4096"
+                Layout.fillWidth: true
+                onEditingFinished: settings.dvdProfile = text
+            }
+            RowLayout {
+                Label { text: "Min MB/s" }
+                SpinBox { id: tuneMbps; from: 0; to: 2000; value: 0; editable: true }
+                Label { text: "Samples" }
+                SpinBox { id: tuneSamples; from: 1; to: 20; value: 3; editable: true }
+            }
+            RowLayout {
+                Button {
+                    // Inputs are collected with the asynchronous scan, then tuned on
+                    readonly property bool collecting: win.tuneInputs !== null
+                    text: tuner.running || collecting ? "Cancel Tuning" : "Tune on Batch Folder"
+                    enabled: tuner.running || collecting || (batchSource.text.length > 0 && !scanner.scanning)
+                    onClicked: {
+                        if (collecting) { scanner.cancelScan(); return }
+                        if (tuner.running) { tuner.cancel(); return }
+                        win.tuneInputs = []
+                        scanner.startScan(batchSource.text, batchRecursive.checked, batchCD.checked, batchDVD.checked)
+                    }
+                }
+                Label { text: tuner.status; elide: Text.ElideRight; Layout.fillWidth: true }
+            }
         }
     }
 
@@ -139,7 +379,8 @@ ApplicationWindow {
                     ComboBox { id: jobType; model: ["Create","Verify","Info","Extract"] }
                     Label { text: "Media" }
                     ComboBox { id: media; model: ["CD","DVD"] }
-                    CheckBox { id: delSrc; text: "Delete source on success" }
+                    CheckBox { id: verifyOut; text: "Verify after create" }
+                    CheckBox { id: delSrc; text: "Delete source (after verify)" }
                     CheckBox { id: keepTree; checked: true; text: "Preserve folder structure" }
                     Item { Layout.fillWidth: true }
                 }
@@ -159,8 +400,8 @@ ApplicationWindow {
                     TextField { id: codecs; enabled: adv.checked; placeholderText: "Compression (-c), e.g. lzma,flac"; Layout.fillWidth: true }
                     SpinBox  { id: hs; enabled: adv.checked; from: 0; to: 65536; value: 0; editable: true }
                     Label    { text: "Hunk Size (-hs)"; visible: adv.checked }
-                    SpinBox  { id: np; enabled: adv.checked; from: 1; to: 32; value: 4; editable: true }
-                    Label    { text: "Threads (-np)"; visible: adv.checked }
+                    SpinBox  { id: np; enabled: adv.checked; from: 0; to: 32; value: 0; editable: true }
+                    Label    { text: "Threads (-np, 0 = from budget)"; visible: adv.checked }
                 }
 
                 RowLayout {
@@ -173,8 +414,8 @@ ApplicationWindow {
                             if (adv.checked && hs.value>0)          { extra.push("-hs", String(hs.value)) }
                             if (adv.checked && np.value>0)          { extra.push("-np", String(np.value)) }
                             for (const f of files) {
-                                const id = jobModel.addJob(jobType.currentIndex, media.currentIndex, f, output.text, extra, delSrc.checked, keepTree.checked)
-                                runner.enqueueSimple(id, jobType.currentIndex, media.currentIndex, f, output.text, extra, delSrc.checked, keepTree.checked)
+                                jobModel.addPipeline(jobType.currentIndex, media.currentIndex, f, output.text, extra,
+                                                     delSrc.checked, keepTree.checked, verifyOut.checked)
                             }
                         }
                     }
@@ -191,23 +432,37 @@ ApplicationWindow {
                     CheckBox { id: batchRecursive; text: "Recursive"; checked: true }
                     CheckBox { id: batchCD; text: "CD (.cue/.toc/.gdi)"; checked: true }
                     CheckBox { id: batchDVD; text: "DVD (.iso)"; checked: true }
+                    CheckBox { id: batchSkipDone; text: "Skip up-to-date"; checked: true }
+                    CheckBox {
+                        id: batchArchives; text: "Inside archives"
+                        visible: scanner.archivesSupported
+                        checked: settings.scanArchives
+                        onToggled: settings.scanArchives = checked
+                    }
+                    CheckBox { id: batchDedup; text: "Skip duplicates" }
+                    CheckBox { id: batchLink; text: "Link duplicates"; visible: batchDedup.checked; checked: true }
                     Button {
-                        text: "Add Batch"
+                        text: scanner.scanning ? "Cancel Scan" : "Add Batch"
                         onClicked: {
-                            const extra = []
-                            if (adv.checked && codecs.text.length>0) { extra.push("-c", codecs.text) }
-                            if (adv.checked && hs.value>0)          { extra.push("-hs", String(hs.value)) }
-                            if (adv.checked && np.value>0)          { extra.push("-np", String(np.value)) }
-                            var inputs = scanner.findInputs(batchSource.text, batchRecursive.checked, batchCD.checked, batchDVD.checked)
-                            for (let f of inputs) {
-                                const ext = f.split('.').pop().toLowerCase()
-                                const med = (ext === "iso") ? 1 : 0
-                                const out = scanner.defaultOutputForInvokable(f, jobType.currentIndex, med, output.text, keepTree.checked)
-                                const id = jobModel.addJob(jobType.currentIndex, med, f, out, extra, delSrc.checked, keepTree.checked)
-                                runner.enqueueSimple(id, jobType.currentIndex, med, f, out, extra, delSrc.checked, keepTree.checked)
-                            }
+                            if (scanner.scanning) { scanner.cancelScan(); return }
+                            snapshotBatch(batchParams)
+                            scanner.startScan(batchSource.text, batchRecursive.checked, batchCD.checked, batchDVD.checked,
+                                              output.text, jobType.currentIndex, keepTree.checked, batchSkipDone.checked,
+                                              batchDedup.checked, batchArchives.visible && batchArchives.checked)
                         }
                     }
+                    Button {
+                        text: watcher.watching ? "Stop Watching" : "Watch"
+                        ToolTip.visible: hovered
+                        ToolTip.text: "Queue new discs dropped into the source folder as soon as all their files are in"
+                        onClicked: {
+                            if (watcher.watching) { watcher.stop(); return }
+                            snapshotBatch(watchParams)
+                            watcher.start([batchSource.text], batchRecursive.checked, batchCD.checked, batchDVD.checked,
+                                          batchArchives.visible && batchArchives.checked)
+                        }
+                    }
+                    Label { id: scanStatus; color: "#8aa"; visible: scanner.scanning || watcher.watching || batchParams.dupCount > 0 }
                     Button { text: "Final Report"; onClicked: reportDialog.open() }
                 }
             }
@@ -216,24 +471,110 @@ ApplicationWindow {
         // Queue view
         Frame {
             padding: 0
-            ListView {
-                anchors.fill: parent; model: jobModel; clip: true
-                delegate: Frame {
-                    width: ListView.view.width; padding: 12
-                    background: Rectangle { color: "#121315"; radius: 8 }
-                    ColumnLayout {
-                        spacing: 6
-                        RowLayout {
-                            Label { text: "Job: " + model.id; font.bold: true }
-                            Label { text: ["Create","Verify","Info","Extract"][type] + " • " + (media===0?"CD":"DVD"); color: "#8aa" }
-                            Item { Layout.fillWidth: true }
-                            Label { text: status; color: status==="Failed" ? "#e66" : (status==="Done" ? "#6e6" : "#ccc") }
+            ColumnLayout {
+                anchors.fill: parent
+                spacing: 0
+                RowLayout {
+                    Layout.margins: 6
+                    ButtonGroup { id: statusGroup }
+                    Repeater {
+                        model: ["", "Queued", "Running", "Done", "Failed"]
+                        ToolButton {
+                            required property string modelData
+                            text: (modelData === "" ? "All" : modelData) + " (" + statusCount(modelData) + ")"
+                            checkable: true
+                            checked: jobFilter.status === modelData
+                            ButtonGroup.group: statusGroup
+                            onClicked: jobFilter.status = modelData
                         }
-                        ProgressBar { value: progress/100.0 }
-                        TextArea { text: log; readOnly: true; wrapMode: Text.WordWrap; height: 90 }
-                        RowLayout {
-                            Item { Layout.fillWidth: true }
-                            Button { text: "Remove"; onClicked: jobModel.removeJob(model.id) }
+                    }
+                    ComboBox {
+                        model: ["Any type", "Create", "Verify", "Info", "Extract", "Delete source"]
+                        onActivated: jobFilter.type = currentIndex - 1
+                    }
+                    ComboBox {
+                        model: ["CD & DVD", "CD", "DVD"]
+                        onActivated: jobFilter.media = currentIndex - 1
+                    }
+                    TextField {
+                        id: searchField
+                        placeholderText: "Search paths"
+                        Layout.fillWidth: true
+                        onTextChanged: searchDelay.restart()
+                        Timer { id: searchDelay; interval: 250; onTriggered: jobFilter.search = searchField.text }
+                    }
+                    CheckBox {
+                        text: "Group by folder"
+                        checked: jobFilter.grouped
+                        onToggled: jobFilter.grouped = checked
+                    }
+                    Label { text: jobFilter.count + " shown"; color: "#8aa" }
+                }
+                ListView {
+                    Layout.fillWidth: true; Layout.fillHeight: true
+                    model: jobFilter; clip: true
+                    section.property: jobFilter.grouped ? "sourceDir" : ""
+                    section.delegate: Label {
+                        required property string section
+                        text: section; font.bold: true; color: "#8aa"; padding: 6
+                    }
+                    delegate: Frame {
+                        // Logs are only fetched and laid out while expanded
+                        property bool expanded: false
+                        width: ListView.view.width; padding: 12
+                        background: Rectangle { color: "#121315"; radius: 8 }
+                        ColumnLayout {
+                            spacing: 6
+                            RowLayout {
+                                Label { text: "Job: " + model.id; font.bold: true }
+                                Label { text: ["Create","Verify","Info","Extract","Delete source"][type] + " • " + (media===0?"CD":"DVD"); color: "#8aa" }
+                                Item { Layout.fillWidth: true }
+                                Label { text: "ratio " + ratio.toFixed(1) + "%"; visible: ratio >= 0; color: "#8aa" }
+                                Label {
+                                    visible: status === "Running" && mbps > 0
+                                    text: mbps.toFixed(1) + " MB/s" + (eta >= 0 ? " • ETA " + Math.floor(eta/60) + "m" + (eta%60) + "s" : "")
+                                    color: "#8aa"
+                                }
+                                Label { text: status; color: status==="Failed" ? "#e66" : (status==="Done" ? "#6e6" : "#ccc") }
+                            }
+                            ProgressBar { value: progress/100.0 }
+                            Label {
+                                visible: info !== undefined && info.version !== undefined
+                                text: visible ? ("CHD v" + info.version + " • " + info.media + " • "
+                                                 + (info.logicalBytes/1048576).toFixed(1) + " MB • hunk " + info.hunkBytes
+                                                 + " • " + info.compressors.join("/")) : ""
+                                color: "#8aa"
+                            }
+                            Loader {
+                                active: expanded
+                                visible: active
+                                Layout.fillWidth: true
+                                sourceComponent: TextArea { text: log; readOnly: true; wrapMode: Text.WordWrap; height: 90 }
+                            }
+                            RowLayout {
+                                Item { Layout.fillWidth: true }
+                                Button {
+                                    text: "Run Next"; visible: status==="Queued"
+                                    onClicked: runner.setPriority(model.id, 100)
+                                }
+                                Button {
+                                    text: "Retry"; visible: status==="Failed" && pipeline !== ""
+                                    onClicked: runner.retryPipeline(pipeline)
+                                }
+                                Button {
+                                    text: "Cancel Pipeline"; visible: (status==="Queued" || status==="Running") && pipeline !== ""
+                                    onClicked: runner.cancelPipeline(pipeline)
+                                }
+                                Button {
+                                    text: expanded ? "Hide Log" : "Log"
+                                    onClicked: expanded = !expanded
+                                }
+                                Button {
+                                    text: "Full Log"
+                                    onClicked: { logDialog.text = logs.fullLog(model.id); logDialog.open() }
+                                }
+                                Button { text: "Remove"; onClicked: jobModel.removeJob(model.id) }
+                            }
                         }
                     }
                 }
@@ -241,22 +582,131 @@ ApplicationWindow {
         }
     }
 
+    // Composer settings for streamed results: the scan's and the watcher's
+    // are kept apart, so adding a batch doesn't change what a watch queues
+    component BatchParams: QtObject {
+        property int type: 0
+        property string out: ""
+        property var extra: []
+        property bool delSrc: false
+        property bool verify: false
+        property bool preserve: true
+        property string source: ""
+        property bool link: false
+        property var dups: ({})      // primary input -> identical inputs
+        property int dupCount: 0
+    }
+    BatchParams { id: batchParams }
+    BatchParams { id: watchParams }
+
+    // Jobs with a status ("" = all), from the model's live counters
+    function statusCount(s) {
+        const n = { "Queued": jobModel.queuedCount, "Running": jobModel.runningCount,
+                    "Done": jobModel.doneCount, "Failed": jobModel.failedCount }
+        return s === "" ? n.Queued + n.Running + n.Done + n.Failed : n[s]
+    }
+
+    // Snapshot the composer so batches streamed in later use these settings
+    function snapshotBatch(params) {
+        const extra = []
+        if (adv.checked && codecs.text.length>0) { extra.push("-c", codecs.text) }
+        if (adv.checked && hs.value>0)          { extra.push("-hs", String(hs.value)) }
+        if (adv.checked && np.value>0)          { extra.push("-np", String(np.value)) }
+        params.type = jobType.currentIndex
+        params.out = output.text
+        params.extra = extra
+        params.delSrc = delSrc.checked
+        params.verify = verifyOut.checked
+        params.preserve = keepTree.checked
+        params.source = batchSource.text
+        params.link = batchDedup.checked && batchLink.checked
+        params.dups = ({})
+        params.dupCount = 0
+    }
+
+    function queueBatch(inputs, sourceRoot, params) {
+        for (let f of inputs) {
+            if (watcher.watching) {
+                if (watchedQueued[f] !== undefined) continue
+                watchedQueued[f] = true
+            }
+            const ext = f.split('.').pop().toLowerCase()
+            const med = (ext === "iso") ? 1 : 0
+            const out = scanner.defaultOutputForInvokable(f, params.type, med, params.out, params.preserve, sourceRoot)
+            const dups = params.dups[f]
+            const links = (params.link && dups !== undefined && out !== "")
+                ? dups.map(d => scanner.defaultOutputForInvokable(d, params.type, med, params.out,
+                                                                  params.preserve, sourceRoot))
+                : []
+            jobModel.addPipeline(params.type, med, f, out, params.extra, params.delSrc,
+                                 params.preserve, params.verify, links)
+        }
+    }
+
+    Connections {
+        target: watcher
+        function onInputsReady(inputs, root) { queueBatch(inputs, root, watchParams) }
+        function onError(message) { scanStatus.text = message }
+        function onWatchingChanged() {
+            watchedQueued = ({})
+            if (watcher.watching) scanStatus.text = "Watching for new discs…"
+        }
+    }
+
+    Connections {
+        target: scanner
+        function onInputsFound(inputs) {
+            if (win.tuneInputs !== null) { win.tuneInputs = win.tuneInputs.concat(inputs); return }
+            queueBatch(inputs, batchParams.source, batchParams)
+        }
+        function onScanFinished(cancelled) {
+            if (win.tuneInputs === null) return
+            const inputs = win.tuneInputs
+            win.tuneInputs = null
+            if (!cancelled) tuner.start(inputs, tuneSamples.value, tuneMbps.value)
+        }
+        function onDuplicatesFound(primary, duplicates) {
+            batchParams.dups[primary] = duplicates
+            batchParams.dupCount += duplicates.length
+        }
+        function onDedupFinished(inputs, bytesHashed, msec) {
+            scanStatus.text = batchParams.dupCount + " duplicates among " + inputs + " inputs • hashed "
+                              + (bytesHashed/1048576).toFixed(0) + " MB in " + (msec/1000).toFixed(1) + " s"
+        }
+        function onScanProgress(dirs, files, matched, skipped) {
+            scanStatus.text = "Scanning… " + dirs + " dirs • " + files + " files • " + matched + " inputs • " + skipped + " up to date"
+        }
+    }
+
+    // Full job log, fetched on demand from the log store
+    Dialog {
+        id: logDialog; modal: true; title: "Job Log"; standardButtons: Dialog.Close
+        property string text: ""
+        width: Math.min(1000, parent.width*0.9); height: Math.min(600, parent.height*0.9)
+        onClosed: text = ""
+        contentItem: ScrollView {
+            TextArea { text: logDialog.text; readOnly: true; wrapMode: TextArea.NoWrap; font.family: "monospace" }
+        }
+    }
+
     // Final report dialog
     Dialog {
         id: reportDialog; modal: true; title: "Final Report"; standardButtons: Dialog.Ok
         width: Math.min(1000, parent.width*0.9); height: Math.min(600, parent.height*0.9)
+        // Rendered when opened rather than bound, so finishing jobs don't re-render it
+        onAboutToShow: md.text = report.asMarkdown()
+        onClosed: md.text = ""
         contentItem: ColumnLayout {
             spacing: 8; padding: 12
             Label {
                 text:
-                    "Total: "  + report.total +
+                    "Conversions: "  + report.total +
                     " • OK: "  + report.ok +
-                    " • Failed: " + report.failed +
+                    " • Failed jobs: " + report.failed +
                     " • Saved: "  + report.savedPct.toFixed(1) + "%"
             }
             TextArea {
                 id: md; wrapMode: TextArea.NoWrap; readOnly: true
-                text: report.asMarkdown()
                 font.family: "monospace"; Layout.fillWidth: true; Layout.fillHeight: true
             }
             RowLayout {
@@ -269,7 +719,9 @@ ApplicationWindow {
                         clip.text = md.text
                     }
                 }
+                Button { text: "Save Markdown"; onClicked: saveMdDialog.open() }
                 Button { text: "Save as CSV"; onClicked: saveCsvDialog.open() }
+                Button { text: "Clear"; onClicked: { report.reset(); md.text = report.asMarkdown() } }
             }
         }
     }